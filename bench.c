@@ -0,0 +1,340 @@
+// Benchmarks for the grid kernels behind the simulations. Every kernel is timed on a range of canvas
+// sizes and the results are written as CSV, so runs can be diffed to catch regressions.
+//
+// Built and run by `./nob bench`.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#define GRID_IMPLEMENTATION
+#include "grid.h"
+#define WORKERS_IMPLEMENTATION
+#include "workers.h"
+#define PBM_IMPLEMENTATION
+#include "pbm.h"
+#define SHAPES_IMPLEMENTATION
+#include "shapes.h"
+
+#define BENCH_MIN_SAMPLE_SECONDS 20e-6  // batch cheap ops so a single sample is well above timer noise
+#define BENCH_MIN_SECONDS 0.25
+#define BENCH_MIN_SAMPLES 16
+#define BENCH_MAX_SAMPLES 4096
+#define BENCH_MASK_PATH "./resources/dvd.pbm"  // the logo the dvd screen bounces around
+#define BENCH_LINES 1024
+
+typedef struct {
+    int cols;
+    int rows;
+} BenchSize;
+
+static const BenchSize benchSizes[] = {
+    {160, 120},
+    {800, 600},
+    {1920, 1080},
+    {3840, 2160},
+    {7680, 4320},
+};
+
+typedef struct {
+    Grid grid;
+    const Grid *mask;
+    const GridSpans *maskSpans;  // the mask compiled the way the dvd screen XORs it
+    WorkerPool *workers;  // for the -mt cases, which split the work in bands like the app does
+    Grid next;  // the generation after `grid`, for Life
+    Grid logo;
+    GridSpans logoSpans;
+    size_t logoCells;
+    ShapeCache *shapes;
+    GridSegment lines[BENCH_LINES];
+    size_t lineCells;
+    size_t circleCells;
+    unsigned char *bytes;
+    size_t iteration;
+} BenchContext;
+
+// A kernel runs one operation and returns how many tiles it processed.
+typedef size_t (*BenchKernel)(BenchContext *context);
+
+typedef struct {
+    const char *name;
+    BenchKernel run;
+} BenchCase;
+
+typedef struct {
+    size_t samples;
+    size_t opsPerSample;
+    double nsPerOp;
+    double p50;
+    double p90;
+    double p99;
+    double cellsPerSecond;
+} BenchResult;
+
+static size_t benchLine(BenchContext *context) {
+    GridSegment l = context->lines[context->iteration++ % BENCH_LINES];
+    gridXorLine(&context->grid, l.x1, l.y1, l.x2, l.y2);
+    int dx = abs(l.x2 - l.x1), dy = abs(l.y2 - l.y1);
+    return dx > dy ? dx : dy;
+}
+
+// The whole set of segments in one batch, as the lines screen draws them with -line-count.
+static size_t benchLineBatch(BenchContext *context) {
+    gridXorLines(&context->grid, context->lines, BENCH_LINES);
+    return context->lineCells;
+}
+
+// The clock's ring: centered, with a radius of 3/8 of the canvas height.
+static size_t benchCircle(BenchContext *context) {
+    Grid *grid = &context->grid;
+    gridXorCircle(grid, grid->cols / 2, grid->rows / 2, grid->rows / 2 * 3 / 4);
+    return context->circleCells;
+}
+
+// The same ring, XORed back in from the shape cache.
+static size_t benchCircleCached(BenchContext *context) {
+    Grid *grid = &context->grid;
+    shapeXorCircle(context->shapes, grid, grid->cols / 2, grid->rows / 2, grid->rows / 2 * 3 / 4);
+    return context->circleCells;
+}
+
+// One DVD logo, XORed from its spans.
+static size_t benchDvd(BenchContext *context) {
+    Grid *grid = &context->grid;
+    size_t i = context->iteration++;
+    int x = i * 7 % (grid->cols - context->mask->cols);
+    int y = i * 3 % (grid->rows - context->mask->rows);
+    gridXorSpans(grid, context->maskSpans, x, y);
+    return (size_t)context->mask->cols * context->mask->rows;
+}
+
+// A logo a quarter of the canvas big, made of long runs: a solid disc with a ring cut out of it.
+static size_t benchLogoBits(BenchContext *context) {
+    Grid *grid = &context->grid;
+    size_t i = context->iteration++;
+    gridXorMask(grid, &context->logo, i * 7 % (grid->cols - context->logo.cols), i * 3 % (grid->rows - context->logo.rows));
+    return context->logoCells;
+}
+
+static size_t benchLogoSpans(BenchContext *context) {
+    Grid *grid = &context->grid;
+    size_t i = context->iteration++;
+    gridXorSpans(grid, &context->logoSpans, i * 7 % (grid->cols - context->logo.cols), i * 3 % (grid->rows - context->logo.rows));
+    return context->logoCells;
+}
+
+// One Life generation over the whole canvas, single-threaded.
+static size_t benchLife(BenchContext *context) {
+    gridLifeRows(&context->grid, &context->next, GRID_LIFE_CONWAY, 0, context->grid.rows);
+    return (size_t)context->grid.cols * context->grid.rows;
+}
+
+static void lifeBand(void *context, int y1, int y2) {
+    BenchContext *benchContext = context;
+    gridLifeRows(&benchContext->grid, &benchContext->next, GRID_LIFE_CONWAY, y1, y2);
+}
+
+// The same generation split in bands over the worker pool, as the life screen steps it.
+static size_t benchLifeThreaded(BenchContext *context) {
+    workerPoolRun(context->workers, 0, context->grid.rows, lifeBand, context);
+    return (size_t)context->grid.cols * context->grid.rows;
+}
+
+static size_t benchInitGrid(BenchContext *context) {
+    gridRandomize(&context->grid, ++context->iteration);
+    return (size_t)context->grid.cols * context->grid.rows;
+}
+
+static size_t benchUploadFull(BenchContext *context) {
+    gridToBytes(&context->grid, context->bytes, 0, 245);
+    return (size_t)context->grid.cols * context->grid.rows;
+}
+
+static void toBytesBand(void *context, int y1, int y2) {
+    BenchContext *benchContext = context;
+    const Grid *grid = &benchContext->grid;
+    gridRectToBytes(grid, (GridRect){0, y1, grid->cols, y2}, benchContext->bytes + (size_t)y1 * grid->cols, 0, 245);
+}
+
+// The full conversion split in bands over the worker pool, as drawGrid() does it.
+static size_t benchUploadFullThreaded(BenchContext *context) {
+    workerPoolRun(context->workers, 0, context->grid.rows, toBytesBand, context);
+    return (size_t)context->grid.cols * context->grid.rows;
+}
+
+// What drawGrid() converts for a frame in which only the DVD logo moved.
+static size_t benchUploadDirty(BenchContext *context) {
+    Grid *grid = &context->grid;
+    GridRect dirty = {0, 0, context->mask->cols + 1, context->mask->rows + 1};
+    gridRectToBytes(grid, dirty, context->bytes, 0, 245);
+    return (size_t)(dirty.x2 - dirty.x1) * (dirty.y2 - dirty.y1);
+}
+
+static const BenchCase benchCases[] = {
+    {"line", benchLine},
+    {"line-batch", benchLineBatch},
+    {"circle", benchCircle},
+    {"circle-cached", benchCircleCached},
+    {"dvd", benchDvd},
+    {"logo-bits", benchLogoBits},
+    {"logo-spans", benchLogoSpans},
+    {"life", benchLife},
+    {"life-mt", benchLifeThreaded},
+    {"initGrid", benchInitGrid},
+    {"upload-full", benchUploadFull},
+    {"upload-full-mt", benchUploadFullThreaded},
+    {"upload-dirty", benchUploadDirty},
+};
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, size_t count, double p) {
+    size_t i = (size_t)ceil(p * count);
+    return sorted[i == 0 ? 0 : i - 1];
+}
+
+static BenchResult runCase(BenchCase benchCase, BenchContext *context) {
+    static double samples[BENCH_MAX_SAMPLES];
+    BenchResult result = {0};
+
+    // Find how many ops make up a sample.
+    result.opsPerSample = 1;
+    for (;;) {
+        double start = nob_now_seconds();
+        for (size_t i = 0; i < result.opsPerSample; i++) benchCase.run(context);
+        if (nob_now_seconds() - start >= BENCH_MIN_SAMPLE_SECONDS) break;
+        result.opsPerSample *= 2;
+    }
+
+    size_t cells = 0;
+    double total = 0;
+    while (result.samples < BENCH_MAX_SAMPLES && (result.samples < BENCH_MIN_SAMPLES || total < BENCH_MIN_SECONDS)) {
+        double start = nob_now_seconds();
+        for (size_t i = 0; i < result.opsPerSample; i++) cells += benchCase.run(context);
+        double elapsed = nob_now_seconds() - start;
+
+        samples[result.samples++] = elapsed * 1e9 / result.opsPerSample;
+        total += elapsed;
+    }
+
+    qsort(samples, result.samples, sizeof(samples[0]), compareDoubles);
+    result.nsPerOp = total * 1e9 / (result.samples * result.opsPerSample);
+    result.p50 = percentile(samples, result.samples, 0.50);
+    result.p90 = percentile(samples, result.samples, 0.90);
+    result.p99 = percentile(samples, result.samples, 0.99);
+    result.cellsPerSecond = cells / total;
+    return result;
+}
+
+static bool loadContext(BenchContext *context, BenchSize size, const Grid *mask, const GridSpans *maskSpans, WorkerPool *workers) {
+    *context = (BenchContext){.mask = mask, .maskSpans = maskSpans, .workers = workers};
+    context->grid = gridAlloc(size.rows, size.cols);
+    context->next = gridAlloc(size.rows, size.cols);
+    context->bytes = malloc((size_t)size.rows * size.cols);
+    context->shapes = shapeCacheCreate(1 << 20);
+    if (!context->grid.words || !context->next.words || !context->bytes || !context->shapes) return false;
+
+    gridRandomize(&context->grid, 1);
+
+    // Fixed pseudo-random segments with both ends on the canvas.
+    srand(3);
+    for (size_t i = 0; i < BENCH_LINES; i++) {
+        GridSegment l = {rand() % size.cols, rand() % size.rows, rand() % size.cols, rand() % size.rows};
+        context->lines[i] = l;
+        int dx = abs(l.x2 - l.x1), dy = abs(l.y2 - l.y1);
+        context->lineCells += dx > dy ? dx : dy;
+    }
+
+    Grid ring = gridAlloc(size.rows, size.cols);
+    if (!ring.words) return false;
+    gridXorCircle(&ring, size.cols / 2, size.rows / 2, size.rows / 2 * 3 / 4);
+    for (size_t w = 0; w < (size_t)ring.rows * ring.stride; w++) context->circleCells += __builtin_popcountll(ring.words[w]);
+    gridFree(&ring);
+
+    context->logo = gridAlloc(size.rows / 2, size.cols / 2);
+    if (!context->logo.words) return false;
+    int radius = context->logo.rows / 2 - 1;
+    for (int dy = -radius; dy <= radius; dy++) {
+        int dx = (int)sqrt((double)radius * radius - (double)dy * dy);
+        gridXorSpan(&context->logo, context->logo.rows / 2 + dy, context->logo.cols / 2 - dx, context->logo.cols / 2 + dx + 1);
+    }
+    gridXorCircle(&context->logo, context->logo.cols / 2, context->logo.rows / 2, radius / 2);
+    if (!gridCompileSpans(&context->logo, &context->logoSpans)) return false;
+    context->logoCells = (size_t)context->logo.cols * context->logo.rows;
+
+    return true;
+}
+
+static void unloadContext(BenchContext *context) {
+    gridFree(&context->grid);
+    gridFree(&context->next);
+    gridFree(&context->logo);
+    gridFreeSpans(&context->logoSpans);
+    free(context->bytes);
+    shapeCacheDestroy(context->shapes);
+}
+
+int main(int argc, char **argv) {
+    const char *program = nob_shift_args(&argc, &argv);
+    const char *outputPath = "./build/bench.csv";
+    if (argc == 2 && strcmp(argv[0], "-o") == 0) {
+        outputPath = argv[1];
+    } else if (argc != 0) {
+        nob_log(NOB_INFO, "usage: %s [-o <output.csv>]", program);
+        return 1;
+    }
+
+    Grid mask;
+    const char *error;
+    if (!pbmLoad(BENCH_MASK_PATH, true, NULL, &mask, &error)) {
+        nob_log(NOB_ERROR, "Could not load %s: %s.", BENCH_MASK_PATH, error);
+        return 1;
+    }
+    GridSpans maskSpans;
+    if (!gridCompileSpans(&mask, &maskSpans)) {
+        nob_log(NOB_ERROR, "No RAM?");
+        return 1;
+    }
+    WorkerPool *workers = workerPoolCreate(nob_nprocs());
+    if (!workers) nob_log(NOB_WARNING, "Could not start %d threads, the -mt kernels run on one.", nob_nprocs());
+
+    FILE *output = fopen(outputPath, "w");
+    if (!output) {
+        nob_log(NOB_ERROR, "Could not open %s: %s", outputPath, strerror(errno));
+        return 1;
+    }
+    fprintf(output, "kernel,cols,rows,samples,ops_per_sample,ns_per_op,p50_ns,p90_ns,p99_ns,cells_per_s\n");
+
+    printf("%-14s %11s %12s %12s %12s %12s %14s\n", "kernel", "canvas", "ns/op", "p50", "p90", "p99", "cells/s");
+    for (size_t i = 0; i < NOB_ARRAY_LEN(benchSizes); i++) {
+        BenchContext context;
+        if (!loadContext(&context, benchSizes[i], &mask, &maskSpans, workers)) {
+            nob_log(NOB_ERROR, "No RAM?");
+            return 1;
+        }
+
+        for (size_t j = 0; j < NOB_ARRAY_LEN(benchCases); j++) {
+            BenchResult r = runCase(benchCases[j], &context);
+            fprintf(output, "%s,%d,%d,%zu,%zu,%.1f,%.1f,%.1f,%.1f,%.0f\n",
+                    benchCases[j].name, benchSizes[i].cols, benchSizes[i].rows, r.samples, r.opsPerSample,
+                    r.nsPerOp, r.p50, r.p90, r.p99, r.cellsPerSecond);
+            printf("%-14s %5dx%-5d %12.1f %12.1f %12.1f %12.1f %14.3e\n",
+                   benchCases[j].name, benchSizes[i].cols, benchSizes[i].rows,
+                   r.nsPerOp, r.p50, r.p90, r.p99, r.cellsPerSecond);
+        }
+
+        unloadContext(&context);
+    }
+
+    fclose(output);
+    workerPoolDestroy(workers);
+    gridFreeSpans(&maskSpans);
+    gridFree(&mask);
+    nob_log(NOB_INFO, "Results written to %s", outputPath);
+    return 0;
+}
@@ -0,0 +1,743 @@
+// Bit-packed grid of tiles: every row is stored as 64-bit words, one bit per tile, with the tile at
+// column x living in bit (x % 64) of word (x / 64). Bits past the last column are always kept at 0.
+// Rows are padded to a multiple of GRID_ROW_ALIGN_WORDS words and the storage is aligned to
+// GRID_ALIGNMENT bytes, so every row starts on a boundary wide SIMD loads are happy with.
+//
+// Like nob.h, this is a single-header library: define GRID_IMPLEMENTATION in exactly one translation
+// unit before including it.
+
+#ifndef GRID_H_
+#define GRID_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define GRID_WORD_BITS 64
+#define GRID_ALIGNMENT 64
+#define GRID_ROW_ALIGN_WORDS 4
+
+typedef struct {
+    int rows;
+    int cols;
+    int stride;  // words per row, including padding
+    uint64_t *words;
+} Grid;
+
+// Half-open rectangle of tiles [x1, x2) x [y1, y2), used to report which part of a grid changed.
+typedef struct {
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+} GridRect;
+
+#define GRID_RECT_EMPTY ((GridRect){0, 0, 0, 0})
+
+// Returns a cleared grid, or one with `words` set to NULL if it couldn't be allocated.
+Grid gridAlloc(int rows, int cols);
+void gridFree(Grid *grid);
+void gridClear(Grid *grid);
+
+// Fill the grid with uniformly random tiles, 64 at a time.
+void gridRandomize(Grid *grid, uint64_t seed);
+
+// Same as gridRandomize(), but only for rows [y1, y2). Every row gets its own stream derived from
+// the seed, so randomizing a grid in bands gives the same tiles as doing it in one go.
+void gridRandomizeRows(Grid *grid, uint64_t seed, int y1, int y2);
+
+// Flip tiles [x1, x2) of row y. The span is clipped to the grid.
+void gridXorSpan(Grid *grid, int y, int x1, int x2);
+
+// XOR `width` bits taken from `bits` (packed the same way as a grid row) into row y, starting at
+// column x. The bits have to fit in the row.
+void gridXorBits(Grid *grid, int y, int x, const uint64_t *bits, int width);
+
+// XOR every row of `mask` into the grid with the mask's top-left corner at (x, y). The mask has to
+// fit in the grid. Returns the rectangle it touched.
+GridRect gridXorMask(Grid *grid, const Grid *mask, int x, int y);
+
+// Same as gridXorMask(), but only for the grid rows in [y1, y2).
+void gridXorMaskRows(Grid *grid, const Grid *mask, int x, int y, int y1, int y2);
+
+// A mask compiled into runs of set tiles, row by row. XORing it costs one span per run plus the
+// words the runs cover, so the empty parts of a mask are free and a solid run is XORed with ~0
+// without reading the mask at all. Pays off over gridXorMask() for big masks of long runs.
+typedef struct {
+    int x1;
+    int x2;
+} GridSpan;
+
+typedef struct {
+    int rows;
+    int cols;
+    GridRect bounds;  // the set tiles, relative to the mask's top-left corner
+    int spanCount;
+    GridSpan *spans;  // the spans of row y are spans[rowStarts[y]] up to spans[rowStarts[y + 1]]
+    int *rowStarts;
+} GridSpans;
+
+// Compile the set tiles of `mask` into spans. Returns false if it ran out of memory.
+bool gridCompileSpans(const Grid *mask, GridSpans *spans);
+void gridFreeSpans(GridSpans *spans);
+
+// XOR the spans into the grid with the mask's top-left corner at (x, y). The mask has to fit in the
+// grid. Returns the rectangle of set tiles it flipped, which may be smaller than the mask.
+GridRect gridXorSpans(Grid *grid, const GridSpans *spans, int x, int y);
+
+// Same as gridXorSpans(), but only for the grid rows in [y1, y2).
+void gridXorSpansRows(Grid *grid, const GridSpans *spans, int x, int y, int y1, int y2);
+
+// Flip the tiles between (x1, y1) and (x2, y2), the last two steps towards (x2, y2) excluded. The
+// endpoints may lie anywhere: the line is clipped to the grid up front, so only the tiles on it get
+// walked. Returns the rectangle it may have touched.
+GridRect gridXorLine(Grid *grid, int x1, int y1, int x2, int y2);
+
+typedef struct {
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+} GridSegment;
+
+// gridXorLine() for a whole batch of segments. Returns the rectangle they may have touched.
+GridRect gridXorLines(Grid *grid, const GridSegment *segments, size_t count);
+
+// Same as gridXorLines(), but only for the grid rows in [y1, y2). Every segment is clipped to the
+// band, so splitting the rows in bands flips exactly the same tiles as doing it in one go.
+void gridXorLinesRows(Grid *grid, const GridSegment *segments, size_t count, int y1, int y2);
+
+// Flip the ring of tiles whose distance from (x, y), rounded to the nearest integer, equals radius.
+// Walks the rows of the ring incrementally with integer math, so it costs O(radius) span XORs
+// instead of a sqrt per tile of the grid. Returns the rectangle it touched.
+GridRect gridXorCircle(Grid *grid, int x, int y, int radius);
+
+// Same as gridXorCircle(), but only for the grid rows in [y1, y2). The cost is proportional to the
+// number of rows of the ring in there.
+void gridXorCircleRows(Grid *grid, int x, int y, int radius, int y1, int y2);
+
+// Life-like rule: bit n of `birth` is set if a dead tile with n live neighbors comes to life, bit n
+// of `survive` if a live one with n live neighbors stays alive. Conway's Life is B3/S23.
+typedef struct {
+    uint16_t birth;
+    uint16_t survive;
+} GridLifeRule;
+
+#define GRID_LIFE_CONWAY ((GridLifeRule){.birth = 1 << 3, .survive = (1 << 2) | (1 << 3)})
+
+// Write the next generation of rows [y1, y2) of `src` into `dst`, which has to be the same size.
+// Everything past the edges of the grid counts as dead. Neighbor counts are added up bit-sliced, 64
+// tiles per word, over as many words at once as the vector extensions of the compiler allow.
+void gridLifeRows(const Grid *src, Grid *dst, GridLifeRule rule, int y1, int y2);
+
+// FNV-1a hash of the tiles, handy for checking that two runs ended up in the same state.
+uint64_t gridChecksum(const Grid *grid);
+
+// Expand the grid to one byte per tile, `on` for set tiles and `off` for the rest.
+void gridToBytes(const Grid *grid, unsigned char *bytes, unsigned char on, unsigned char off);
+
+// Same as gridToBytes(), but only for the tiles in `rect`, packed tightly (rect width bytes per row).
+void gridRectToBytes(const Grid *grid, GridRect rect, unsigned char *bytes, unsigned char on, unsigned char off);
+
+static inline bool gridRectIsEmpty(GridRect rect) {
+    return rect.x1 >= rect.x2 || rect.y1 >= rect.y2;
+}
+
+static inline GridRect gridRectUnion(GridRect a, GridRect b) {
+    if (gridRectIsEmpty(a)) return b;
+    if (gridRectIsEmpty(b)) return a;
+    return (GridRect){
+        .x1 = a.x1 < b.x1 ? a.x1 : b.x1,
+        .y1 = a.y1 < b.y1 ? a.y1 : b.y1,
+        .x2 = a.x2 > b.x2 ? a.x2 : b.x2,
+        .y2 = a.y2 > b.y2 ? a.y2 : b.y2,
+    };
+}
+
+static inline GridRect gridRectClip(const Grid *grid, GridRect rect) {
+    if (rect.x1 < 0) rect.x1 = 0;
+    if (rect.y1 < 0) rect.y1 = 0;
+    if (rect.x2 > grid->cols) rect.x2 = grid->cols;
+    if (rect.y2 > grid->rows) rect.y2 = grid->rows;
+    return gridRectIsEmpty(rect) ? GRID_RECT_EMPTY : rect;
+}
+
+// The rectangle spanned by a segment, endpoints included.
+static inline GridRect gridSegmentBounds(GridSegment l) {
+    return (GridRect){
+        .x1 = l.x1 < l.x2 ? l.x1 : l.x2,
+        .y1 = l.y1 < l.y2 ? l.y1 : l.y2,
+        .x2 = (l.x1 > l.x2 ? l.x1 : l.x2) + 1,
+        .y2 = (l.y1 > l.y2 ? l.y1 : l.y2) + 1,
+    };
+}
+
+static inline GridRect gridBounds(const Grid *grid) {
+    return (GridRect){0, 0, grid->cols, grid->rows};
+}
+
+// Number of words of a row that hold tiles, the rest of the stride is padding.
+static inline int gridRowWords(const Grid *grid) {
+    return (grid->cols + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+}
+
+static inline uint64_t *gridRow(const Grid *grid, int y) {
+    return grid->words + (size_t)y * grid->stride;
+}
+
+static inline bool gridGet(const Grid *grid, int x, int y) {
+    return (gridRow(grid, y)[x / GRID_WORD_BITS] >> (x % GRID_WORD_BITS)) & 1;
+}
+
+static inline void gridToggle(Grid *grid, int x, int y) {
+    gridRow(grid, y)[x / GRID_WORD_BITS] ^= (uint64_t)1 << (x % GRID_WORD_BITS);
+}
+
+static inline void gridSet(Grid *grid, int x, int y, bool value) {
+    uint64_t bit = (uint64_t)1 << (x % GRID_WORD_BITS);
+    uint64_t *word = &gridRow(grid, y)[x / GRID_WORD_BITS];
+    *word = value ? (*word | bit) : (*word & ~bit);
+}
+
+#endif  // GRID_H_
+
+#if defined(GRID_IMPLEMENTATION) && !defined(GRID_IMPLEMENTED_)
+#define GRID_IMPLEMENTED_  // other headers include this one too
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#    include <malloc.h>
+#endif
+
+static void *gridAlignedAlloc(size_t size) {
+    size = (size + GRID_ALIGNMENT - 1) / GRID_ALIGNMENT * GRID_ALIGNMENT;
+#ifdef _WIN32
+    return _aligned_malloc(size, GRID_ALIGNMENT);
+#else
+    return aligned_alloc(GRID_ALIGNMENT, size);
+#endif
+}
+
+static void gridAlignedFree(void *ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+Grid gridAlloc(int rows, int cols) {
+    int rowWords = (cols + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+    Grid grid = {
+        .rows = rows,
+        .cols = cols,
+        .stride = (rowWords + GRID_ROW_ALIGN_WORDS - 1) / GRID_ROW_ALIGN_WORDS * GRID_ROW_ALIGN_WORDS,
+    };
+    grid.words = gridAlignedAlloc((size_t)rows * grid.stride * sizeof(uint64_t));
+    if (grid.words) gridClear(&grid);
+    return grid;
+}
+
+void gridFree(Grid *grid) {
+    gridAlignedFree(grid->words);
+    grid->words = NULL;
+}
+
+void gridClear(Grid *grid) {
+    memset(grid->words, 0, (size_t)grid->rows * grid->stride * sizeof(uint64_t));
+}
+
+// Mask of the valid bits in the last word of a row.
+static uint64_t gridTailMask(const Grid *grid) {
+    int tail = grid->cols % GRID_WORD_BITS;
+    return tail == 0 ? ~(uint64_t)0 : ((uint64_t)1 << tail) - 1;
+}
+
+// xorshift64*, good enough for noise and much cheaper than a GetRandomValue() per tile.
+static uint64_t gridNextRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// splitmix64 finalizer, spreads consecutive row numbers into unrelated xorshift states.
+static uint64_t gridMix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+void gridRandomize(Grid *grid, uint64_t seed) {
+    gridRandomizeRows(grid, seed, 0, grid->rows);
+}
+
+void gridRandomizeRows(Grid *grid, uint64_t seed, int y1, int y2) {
+    uint64_t tailMask = gridTailMask(grid);
+    int rowWords = gridRowWords(grid);
+    for (int y = y1; y < y2; y++) {
+        uint64_t state = gridMix(seed ^ gridMix(y));
+        if (state == 0) state = 1;  // the only state xorshift can't get out of
+
+        uint64_t *row = gridRow(grid, y);
+        for (int w = 0; w < rowWords; w++) row[w] = gridNextRandom(&state);
+        row[rowWords - 1] &= tailMask;
+    }
+}
+
+void gridXorSpan(Grid *grid, int y, int x1, int x2) {
+    if (y < 0 || y >= grid->rows) return;
+    if (x1 < 0) x1 = 0;
+    if (x2 > grid->cols) x2 = grid->cols;
+    if (x1 >= x2) return;
+
+    uint64_t *row = gridRow(grid, y);
+    int firstWord = x1 / GRID_WORD_BITS;
+    int lastWord = (x2 - 1) / GRID_WORD_BITS;
+    uint64_t firstMask = ~(uint64_t)0 << (x1 % GRID_WORD_BITS);
+    uint64_t lastMask = ~(uint64_t)0 >> (GRID_WORD_BITS - 1 - (x2 - 1) % GRID_WORD_BITS);
+
+    if (firstWord == lastWord) {
+        row[firstWord] ^= firstMask & lastMask;
+        return;
+    }
+
+    row[firstWord] ^= firstMask;
+    for (int w = firstWord + 1; w < lastWord; w++) row[w] = ~row[w];
+    row[lastWord] ^= lastMask;
+}
+
+void gridXorBits(Grid *grid, int y, int x, const uint64_t *bits, int width) {
+    uint64_t *row = gridRow(grid, y);
+    int shift = x % GRID_WORD_BITS;
+    int firstWord = x / GRID_WORD_BITS;
+    int words = (width + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+
+    if (shift == 0) {
+        for (int i = 0; i < words; i++) row[firstWord + i] ^= bits[i];
+        return;
+    }
+
+    // Every source word straddles two destination words. The bits spilling past the end of the row
+    // are zero as long as the source has its tail cleared, so the last spill is only written when
+    // there's a word to write it to.
+    for (int i = 0; i < words; i++) {
+        row[firstWord + i] ^= bits[i] << shift;
+        if (firstWord + i + 1 < grid->stride) row[firstWord + i + 1] ^= bits[i] >> (GRID_WORD_BITS - shift);
+    }
+}
+
+GridRect gridXorMask(Grid *grid, const Grid *mask, int x, int y) {
+    gridXorMaskRows(grid, mask, x, y, y, y + mask->rows);
+    return (GridRect){x, y, x + mask->cols, y + mask->rows};
+}
+
+void gridXorMaskRows(Grid *grid, const Grid *mask, int x, int y, int y1, int y2) {
+    if (y1 < y) y1 = y;
+    if (y2 > y + mask->rows) y2 = y + mask->rows;
+    for (int row = y1; row < y2; row++) {
+        gridXorBits(grid, row, x, gridRow(mask, row - y), mask->cols);
+    }
+}
+
+// Walk the runs of row y with one bit per place where the row changes value, so rows of long runs
+// take a handful of steps. Only counts them when `out` is NULL.
+static int gridRowSpans(const Grid *mask, int y, GridSpan *out, GridRect *bounds) {
+    const uint64_t *row = gridRow(mask, y);
+    int rowWords = gridRowWords(mask);
+    int count = 0;
+    int start = 0;
+    uint64_t carry = 0;  // the last tile of the previous word
+    for (int w = 0; w < rowWords; w++) {
+        uint64_t edges = row[w] ^ ((row[w] << 1) | carry);
+        carry = row[w] >> (GRID_WORD_BITS - 1);
+        while (edges) {
+            int x = w * GRID_WORD_BITS + __builtin_ctzll(edges);
+            edges &= edges - 1;
+            if (gridGet(mask, x, y)) {
+                start = x;
+                continue;
+            }
+            if (out) out[count] = (GridSpan){start, x};
+            count++;
+        }
+    }
+    // Only a run touching the end of a row whose width is a multiple of 64 is still open here.
+    if (carry) {
+        if (out) out[count] = (GridSpan){start, mask->cols};
+        count++;
+    }
+
+    if (out && count > 0) {
+        *bounds = gridRectUnion(*bounds, (GridRect){out[0].x1, y, out[count - 1].x2, y + 1});
+    }
+    return count;
+}
+
+bool gridCompileSpans(const Grid *mask, GridSpans *spans) {
+    *spans = (GridSpans){.rows = mask->rows, .cols = mask->cols, .bounds = GRID_RECT_EMPTY};
+    spans->rowStarts = malloc(((size_t)mask->rows + 1) * sizeof(int));
+    if (!spans->rowStarts) return false;
+
+    for (int y = 0; y < mask->rows; y++) {
+        spans->rowStarts[y] = spans->spanCount;
+        spans->spanCount += gridRowSpans(mask, y, NULL, NULL);
+    }
+    spans->rowStarts[mask->rows] = spans->spanCount;
+
+    spans->spans = malloc(((size_t)spans->spanCount + 1) * sizeof(GridSpan));
+    if (!spans->spans) {
+        gridFreeSpans(spans);
+        return false;
+    }
+    for (int y = 0; y < mask->rows; y++) {
+        gridRowSpans(mask, y, &spans->spans[spans->rowStarts[y]], &spans->bounds);
+    }
+    return true;
+}
+
+void gridFreeSpans(GridSpans *spans) {
+    free(spans->spans);
+    free(spans->rowStarts);
+    spans->spans = NULL;
+    spans->rowStarts = NULL;
+}
+
+GridRect gridXorSpans(Grid *grid, const GridSpans *spans, int x, int y) {
+    gridXorSpansRows(grid, spans, x, y, y, y + spans->rows);
+    if (gridRectIsEmpty(spans->bounds)) return GRID_RECT_EMPTY;
+    return (GridRect){x + spans->bounds.x1, y + spans->bounds.y1, x + spans->bounds.x2, y + spans->bounds.y2};
+}
+
+void gridXorSpansRows(Grid *grid, const GridSpans *spans, int x, int y, int y1, int y2) {
+    if (y1 < y) y1 = y;
+    if (y2 > y + spans->rows) y2 = y + spans->rows;
+    for (int row = y1; row < y2; row++) {
+        const GridSpan *span = &spans->spans[spans->rowStarts[row - y]];
+        const GridSpan *end = &spans->spans[spans->rowStarts[row - y + 1]];
+        for (; span < end; span++) gridXorSpan(grid, row, x + span->x1, x + span->x2);
+    }
+}
+
+static int64_t gridFloorDiv(int64_t a, int64_t b) {
+    return a / b - (a % b != 0 && a < 0);
+}
+
+static int64_t gridCeilDiv(int64_t a, int64_t b) {
+    return -gridFloorDiv(-a, b);
+}
+
+// Narrow [*i1, *i2] down to the steps i for which start + sign * i lies in [lo, hi].
+static void gridClipSteps(int start, int sign, int lo, int hi, int64_t *i1, int64_t *i2) {
+    int64_t first = sign > 0 ? (int64_t)lo - start : (int64_t)start - hi;
+    int64_t last = sign > 0 ? (int64_t)hi - start : (int64_t)start - lo;
+    if (first > *i1) *i1 = first;
+    if (last < *i2) *i2 = last;
+}
+
+// Flip `count` tiles of a line starting at (x, y) with the error term at e. The direction is passed
+// as constants and the function is always inlined, so every octant gets a stepping loop of its own
+// in which the minor axis moves through masks instead of branches.
+static inline __attribute__((always_inline)) void gridLineSteps(Grid *grid, int x, int y, int64_t e, int64_t a, int64_t b,
+                                                                 int64_t count, const bool xMajor, const int sx, const int sy) {
+    uint64_t *words = grid->words;
+    ptrdiff_t offset = (ptrdiff_t)y * grid->stride;
+    ptrdiff_t rowStep = sy * (ptrdiff_t)grid->stride;
+    for (int64_t i = 0; i < count; i++) {
+        words[offset + (unsigned)x / GRID_WORD_BITS] ^= (uint64_t)1 << ((unsigned)x % GRID_WORD_BITS);
+
+        int64_t minorStep = -(int64_t)(e >= 0);  // all ones when the minor axis moves too
+        e += a + (minorStep & (b - a));
+        if (xMajor) {
+            x += sx;
+            offset += rowStep & minorStep;
+        } else {
+            x += sx & minorStep;
+            offset += rowStep;
+        }
+    }
+}
+
+// Bresenham's algorithm generalized to work with any slope, restricted to the tiles in `clip`.
+// Credit: https://www.uobabylon.edu.iq/eprints/publication_2_22893_6215.pdf.
+//
+// After i steps along the major axis the line has moved floor((2 * minor * i + major) / (2 * major))
+// steps along the minor one, so the steps that land in `clip` can be solved for directly and the
+// walk started right where the line enters it.
+static void gridXorLineClipped(Grid *grid, int x1, int y1, int x2, int y2, GridRect clip) {
+    if (gridRectIsEmpty(clip)) return;
+
+    int sx = x2 < x1 ? -1 : 1;
+    int sy = y2 < y1 ? -1 : 1;
+    int64_t dx = x2 < x1 ? (int64_t)x1 - x2 : (int64_t)x2 - x1;
+    int64_t dy = y2 < y1 ? (int64_t)y1 - y2 : (int64_t)y2 - y1;
+    bool xMajor = dx >= dy;
+    int64_t major = xMajor ? dx : dy;
+    int64_t minor = xMajor ? dy : dx;
+
+    // The last two steps towards (x2, y2) are excluded.
+    int64_t i1 = 0, i2 = major - 2;
+    if (xMajor) {
+        gridClipSteps(x1, sx, clip.x1, clip.x2 - 1, &i1, &i2);
+    } else {
+        gridClipSteps(y1, sy, clip.y1, clip.y2 - 1, &i1, &i2);
+    }
+
+    int minorStart = xMajor ? y1 : x1;
+    int minorSign = xMajor ? sy : sx;
+    int minorLo = xMajor ? clip.y1 : clip.x1;
+    int minorHi = (xMajor ? clip.y2 : clip.x2) - 1;
+    if (minor == 0) {
+        if (minorStart < minorLo || minorStart > minorHi) return;
+    } else {
+        // Steps along the minor axis that keep the line in the clip, turned into steps along the major.
+        int64_t k1 = 0, k2 = minor;
+        gridClipSteps(minorStart, minorSign, minorLo, minorHi, &k1, &k2);
+        if (k1 > k2) return;
+        int64_t first = gridCeilDiv(2 * major * k1 - major, 2 * minor);
+        int64_t last = gridCeilDiv(2 * major * (k2 + 1) - major, 2 * minor) - 1;
+        if (first > i1) i1 = first;
+        if (last < i2) i2 = last;
+    }
+    if (i1 > i2) return;
+
+    int64_t k = (2 * minor * i1 + major) / (2 * major);
+    int64_t e = 2 * minor * (i1 + 1) - major - 2 * major * k;
+    int64_t a = 2 * minor;
+    int64_t b = 2 * minor - 2 * major;
+    int64_t count = i2 - i1 + 1;
+    int x = xMajor ? x1 + sx * i1 : x1 + sx * k;
+    int y = xMajor ? y1 + sy * k : y1 + sy * i1;
+
+    switch ((xMajor << 2) | ((sx < 0) << 1) | (sy < 0)) {
+        case 0: gridLineSteps(grid, x, y, e, a, b, count, false, 1, 1); break;
+        case 1: gridLineSteps(grid, x, y, e, a, b, count, false, 1, -1); break;
+        case 2: gridLineSteps(grid, x, y, e, a, b, count, false, -1, 1); break;
+        case 3: gridLineSteps(grid, x, y, e, a, b, count, false, -1, -1); break;
+        case 4: gridLineSteps(grid, x, y, e, a, b, count, true, 1, 1); break;
+        case 5: gridLineSteps(grid, x, y, e, a, b, count, true, 1, -1); break;
+        case 6: gridLineSteps(grid, x, y, e, a, b, count, true, -1, 1); break;
+        case 7: gridLineSteps(grid, x, y, e, a, b, count, true, -1, -1); break;
+    }
+}
+
+GridRect gridXorLine(Grid *grid, int x1, int y1, int x2, int y2) {
+    gridXorLineClipped(grid, x1, y1, x2, y2, gridBounds(grid));
+    return gridRectClip(grid, gridSegmentBounds((GridSegment){x1, y1, x2, y2}));
+}
+
+GridRect gridXorLines(Grid *grid, const GridSegment *segments, size_t count) {
+    GridRect dirty = GRID_RECT_EMPTY;
+    for (size_t i = 0; i < count; i++) {
+        const GridSegment *l = &segments[i];
+        gridXorLineClipped(grid, l->x1, l->y1, l->x2, l->y2, gridBounds(grid));
+        dirty = gridRectUnion(dirty, gridSegmentBounds(*l));
+    }
+    return gridRectClip(grid, dirty);
+}
+
+void gridXorLinesRows(Grid *grid, const GridSegment *segments, size_t count, int y1, int y2) {
+    GridRect clip = gridRectClip(grid, (GridRect){0, y1, grid->cols, y2});
+    for (size_t i = 0; i < count; i++) {
+        const GridSegment *l = &segments[i];
+        gridXorLineClipped(grid, l->x1, l->y1, l->x2, l->y2, clip);
+    }
+}
+
+// Largest r with r^2 <= v, worked out a bit at a time so the grid doesn't need libm.
+static long long gridSqrtFloor(long long v) {
+    if (v <= 0) return 0;
+
+    unsigned long long rest = v, r = 0, bit = 1ULL << 62;
+    while (bit > rest) bit >>= 2;
+    for (; bit; bit >>= 2) {
+        if (rest >= r + bit) {
+            rest -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+    }
+    return r;
+}
+
+// round(sqrt(d)) == radius holds exactly for the integer squared distances d in
+// [radius^2 - radius + 1, radius^2 + radius], with a radius of 0 being just the center.
+static long long gridCircleInnerSq(int radius) {
+    return radius > 0 ? (long long)radius * radius - radius + 1 : 0;
+}
+
+static long long gridCircleOuterSq(int radius) {
+    return (long long)radius * radius + radius;
+}
+
+// Flip the ring's tiles on rows y + direction * dy for dy in [dyFrom, dyTo]. For every dy the ring
+// covers |dx| in [inner, outer]: outer is the largest dx with dx^2 + dy^2 <= outerSq and inner the
+// smallest one with dx^2 + dy^2 >= innerSq. Both only shrink as dy grows, so they're computed once
+// for dyFrom and then stepped down instead of recomputed.
+static void gridXorCircleHalf(Grid *grid, int x, int y, int radius, int direction, long long dyFrom, long long dyTo) {
+    if (dyFrom > dyTo) return;
+
+    long long outerSq = gridCircleOuterSq(radius);
+    long long innerSq = gridCircleInnerSq(radius);
+    long long outer = gridSqrtFloor(outerSq - dyFrom * dyFrom);
+    long long innerLeft = innerSq - dyFrom * dyFrom;
+    long long inner = innerLeft <= 0 ? 0 : gridSqrtFloor(innerLeft - 1) + 1;
+
+    for (long long dy = dyFrom; dy <= dyTo; dy++) {
+        long long dySq = dy * dy;
+        while (outer * outer + dySq > outerSq) outer--;
+        while (inner > 0 && (inner - 1) * (inner - 1) + dySq >= innerSq) inner--;
+        if (inner > outer) continue;
+
+        int row = y + direction * dy;
+        if (inner == 0) {
+            gridXorSpan(grid, row, x - outer, x + outer + 1);
+        } else {
+            gridXorSpan(grid, row, x - outer, x - inner + 1);
+            gridXorSpan(grid, row, x + inner, x + outer + 1);
+        }
+    }
+}
+
+GridRect gridXorCircle(Grid *grid, int x, int y, int radius) {
+    if (radius < 0) return GRID_RECT_EMPTY;
+
+    gridXorCircleRows(grid, x, y, radius, 0, grid->rows);
+    return gridRectClip(grid, (GridRect){x - radius, y - radius, x + radius + 1, y + radius + 1});
+}
+
+void gridXorCircleRows(Grid *grid, int x, int y, int radius, int y1, int y2) {
+    if (radius < 0) return;
+    if (y1 < 0) y1 = 0;
+    if (y2 > grid->rows) y2 = grid->rows;
+    if (y1 < y - radius) y1 = y - radius;
+    if (y2 > y + radius + 1) y2 = y + radius + 1;
+    if (y1 >= y2) return;
+
+    // Rows from the center down, then the ones above it.
+    if (y2 > y) gridXorCircleHalf(grid, x, y, radius, 1, (y1 > y ? y1 : y) - y, y2 - 1 - y);
+    if (y1 < y) gridXorCircleHalf(grid, x, y, radius, -1, y - (y2 < y ? y2 - 1 : y - 1), y - y1);
+}
+
+// Words the Life kernel works on at once. Rows are padded to GRID_ROW_ALIGN_WORDS words, so they
+// always hold a whole number of these.
+#if defined(__GNUC__) && !defined(GRID_NO_VECTORS)
+typedef uint64_t GridLifeWords __attribute__((vector_size(GRID_ROW_ALIGN_WORDS * sizeof(uint64_t))));
+#    define GRID_LIFE_LANES GRID_ROW_ALIGN_WORDS
+#else
+typedef uint64_t GridLifeWords;
+#    define GRID_LIFE_LANES 1
+#endif
+
+// Load the words of `row` starting at `w`, which may be one before the first or run one past the
+// stride, with zeros out there. Vectors only go through pointers, so the helpers don't depend on how
+// the ABI passes them around.
+static inline void gridLifeLoad(const uint64_t *row, int w, int stride, GridLifeWords *words) {
+    if (w >= 0 && w + GRID_LIFE_LANES <= stride) {
+        memcpy(words, row + w, sizeof(*words));
+        return;
+    }
+
+    uint64_t lanes[GRID_LIFE_LANES];
+    for (int i = 0; i < GRID_LIFE_LANES; i++) lanes[i] = w + i >= 0 && w + i < stride ? row[w + i] : 0;
+    memcpy(words, lanes, sizeof(*words));
+}
+
+// A row's words at `w` together with the same words shifted so every tile lines up with its west
+// and east neighbor. A NULL row is one past the top or bottom edge, all dead.
+static inline void gridLifeNeighbors(const uint64_t *row, int w, int stride, GridLifeWords *west, GridLifeWords *center, GridLifeWords *east) {
+    if (!row) {
+        memset(center, 0, sizeof(*center));
+        *west = *east = *center;
+        return;
+    }
+
+    GridLifeWords previous, next;
+    gridLifeLoad(row, w, stride, center);
+    gridLifeLoad(row, w - 1, stride, &previous);
+    gridLifeLoad(row, w + 1, stride, &next);
+    *west = (*center << 1) | (previous >> (GRID_WORD_BITS - 1));
+    *east = (*center >> 1) | (next << (GRID_WORD_BITS - 1));
+}
+
+void gridLifeRows(const Grid *src, Grid *dst, GridLifeRule rule, int y1, int y2) {
+    if (y1 < 0) y1 = 0;
+    if (y2 > src->rows) y2 = src->rows;
+    int stride = src->stride;
+    int rowWords = gridRowWords(src);
+    uint64_t tailMask = gridTailMask(src);
+
+    for (int y = y1; y < y2; y++) {
+        const uint64_t *above = y > 0 ? gridRow(src, y - 1) : NULL;
+        const uint64_t *row = gridRow(src, y);
+        const uint64_t *below = y + 1 < src->rows ? gridRow(src, y + 1) : NULL;
+        uint64_t *out = gridRow(dst, y);
+
+        for (int w = 0; w < stride; w += GRID_LIFE_LANES) {
+            GridLifeWords aw, a, ae, cw, c, ce, bw, b, be;
+            gridLifeNeighbors(above, w, stride, &aw, &a, &ae);
+            gridLifeNeighbors(row, w, stride, &cw, &c, &ce);
+            gridLifeNeighbors(below, w, stride, &bw, &b, &be);
+
+            // Add up the 8 neighbors with full adders, one bit plane of the count at a time.
+            GridLifeWords s1 = aw ^ a ^ ae, c1 = (aw & a) | (ae & (aw ^ a));
+            GridLifeWords s2 = bw ^ b ^ be, c2 = (bw & b) | (be & (bw ^ b));
+            GridLifeWords s3 = cw ^ ce, c3 = cw & ce;
+            GridLifeWords b0 = s1 ^ s2 ^ s3, c4 = (s1 & s2) | (s3 & (s1 ^ s2));
+            GridLifeWords t = c1 ^ c2 ^ c3, c5 = (c1 & c2) | (c3 & (c1 ^ c2));
+            GridLifeWords b1 = t ^ c4, c6 = t & c4;
+            GridLifeWords b2 = c5 ^ c6, b3 = c5 & c6;
+
+            GridLifeWords next = c ^ c;  // zero in whatever type GridLifeWords is
+            for (int n = 0; n <= 8; n++) {
+                if (!((rule.birth | rule.survive) >> n & 1)) continue;
+                GridLifeWords is = (n & 1 ? b0 : ~b0) & (n & 2 ? b1 : ~b1) & (n & 4 ? b2 : ~b2) & (n & 8 ? b3 : ~b3);
+                if (rule.birth >> n & 1) next |= is & ~c;
+                if (rule.survive >> n & 1) next |= is & c;
+            }
+            memcpy(out + w, &next, sizeof(next));
+        }
+
+        // Keep the bits past the last column and the padding words at 0.
+        out[rowWords - 1] &= tailMask;
+        for (int w = rowWords; w < stride; w++) out[w] = 0;
+    }
+}
+
+uint64_t gridChecksum(const Grid *grid) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    int rowWords = gridRowWords(grid);
+    for (int y = 0; y < grid->rows; y++) {
+        const uint64_t *row = gridRow(grid, y);
+        for (int w = 0; w < rowWords; w++) {
+            for (int i = 0; i < 8; i++) {
+                hash ^= (row[w] >> (8 * i)) & 0xFF;
+                hash *= 0x100000001B3ULL;
+            }
+        }
+    }
+    return hash;
+}
+
+void gridToBytes(const Grid *grid, unsigned char *bytes, unsigned char on, unsigned char off) {
+    gridRectToBytes(grid, gridBounds(grid), bytes, on, off);
+}
+
+void gridRectToBytes(const Grid *grid, GridRect rect, unsigned char *bytes, unsigned char on, unsigned char off) {
+    int width = rect.x2 - rect.x1;
+    unsigned char flip = on ^ off;
+    for (int y = rect.y1; y < rect.y2; y++) {
+        const uint64_t *row = gridRow(grid, y);
+        unsigned char *out = bytes + (size_t)(y - rect.y1) * width;
+        for (int x = rect.x1; x < rect.x2; x++) {
+            unsigned char bit = (row[x / GRID_WORD_BITS] >> (x % GRID_WORD_BITS)) & 1;
+            out[x - rect.x1] = off ^ (flip & -bit);
+        }
+    }
+}
+
+#endif  // GRID_IMPLEMENTATION
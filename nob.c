@@ -1,5 +1,33 @@
+#include <stdint.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#    include <sys/utime.h>
+#else
+#    include <utime.h>
+#endif
+
 #define NOB_IMPLEMENTATION
 #include "./nob.h"
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_NO_LINEAR  // keeps libm out of nob
+#define STBI_NO_HDR
+// Some of stb_image's helpers are only used by the decoders left out above.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "./raylib/raylib-5.0/src/external/stb_image.h"
+#pragma GCC diagnostic pop
+// The app's own .pbm loader, so the embedded mask accepts exactly what -resources does.
+#define GRID_IMPLEMENTATION
+#include "./grid.h"
+#define WORKERS_IMPLEMENTATION
+#define WORKERS_NO_THREADS  // nob is built without -pthread
+#include "./workers.h"
+#define PBM_IMPLEMENTATION
+#include "./pbm.h"
+
+// Most compiles run in parallel, 0 is one per CPU.
+static size_t maxParallelJobs = 0;
 
 static const char *raylibModules[] = {
     "raudio",
@@ -12,107 +40,842 @@ static const char *raylibModules[] = {
     "utils",
 };
 
-bool buildRaylib() {
+// raylib is pruned down to what the app uses: these modules aren't built at all, and these features
+// are left out of the generated config header, which replaces raylib's own config.h. Everything
+// the app doesn't call (audio, 3D, gestures, screen capture, file formats other than PNG) goes.
+// -stock-raylib builds raylib as it comes instead, for comparison.
+static const char *unusedRaylibModules[] = {
+    "raudio",
+    "rmodels",
+};
+
+static const char *unusedRaylibFeatures[] = {
+    "SUPPORT_MODULE_RMODELS",
+    "SUPPORT_MODULE_RAUDIO",
+    "SUPPORT_CAMERA_SYSTEM",
+    "SUPPORT_GESTURES_SYSTEM",
+    "SUPPORT_MOUSE_GESTURES",
+    "SUPPORT_SSH_KEYBOARD_RPI",
+    "SUPPORT_SCREEN_CAPTURE",
+    "SUPPORT_GIF_RECORDING",
+    "SUPPORT_COMPRESSION_API",
+    "SUPPORT_AUTOMATION_EVENTS",
+    "SUPPORT_FILEFORMAT_GIF",
+    "SUPPORT_FILEFORMAT_QOI",
+    "SUPPORT_FILEFORMAT_DDS",
+    "SUPPORT_IMAGE_EXPORT",
+    "SUPPORT_IMAGE_GENERATION",
+    "SUPPORT_FILEFORMAT_FNT",
+    "SUPPORT_FILEFORMAT_TTF",
+    "SUPPORT_FILEFORMAT_OBJ",
+    "SUPPORT_FILEFORMAT_MTL",
+    "SUPPORT_FILEFORMAT_IQM",
+    "SUPPORT_FILEFORMAT_GLTF",
+    "SUPPORT_FILEFORMAT_VOX",
+    "SUPPORT_FILEFORMAT_M3D",
+    "SUPPORT_MESH_GENERATION",
+    "SUPPORT_FILEFORMAT_WAV",
+    "SUPPORT_FILEFORMAT_OGG",
+    "SUPPORT_FILEFORMAT_MP3",
+    "SUPPORT_FILEFORMAT_QOA",
+    "SUPPORT_FILEFORMAT_XM",
+    "SUPPORT_FILEFORMAT_MOD",
+};
+
+#define RAYLIB_CONFIG_PATH "./build/raylib/config.h"
+
+static bool stockRaylib = false;
+
+bool isListed(Nob_String_View name, const char **list, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (nob_sv_eq(name, nob_sv_from_cstr(list[i]))) return true;
+    }
+    return false;
+}
+
+// Copy raylib's config.h with the unused features commented out. The file is only rewritten when
+// its contents change, so it doesn't make everything out of date on every run.
+bool generateRaylibConfig(void) {
+    bool result = true;
+
+    Nob_String_Builder config = {0};
+    Nob_String_Builder generated = {0};
+    Nob_String_Builder existing = {0};
+
+    if (!nob_read_entire_file("./raylib/raylib-5.0/src/config.h", &config)) nob_return_defer(false);
+
+    nob_sb_append_cstr(&generated, "// Generated by nob.c from raylib's config.h, don't edit.\n");
+    Nob_String_View lines = nob_sv_from_parts(config.items, config.count);
+    while (lines.count > 0) {
+        Nob_String_View line = nob_sv_chop_by_delim(&lines, '\n');
+        Nob_String_View rest = nob_sv_trim(line);
+        Nob_String_View directive = nob_sv_chop_by_delim(&rest, ' ');
+        rest = nob_sv_trim(rest);
+        Nob_String_View name = nob_sv_chop_by_delim(&rest, ' ');
+
+        if (nob_sv_eq(directive, nob_sv_from_cstr("#define")) && isListed(name, unusedRaylibFeatures, NOB_ARRAY_LEN(unusedRaylibFeatures))) {
+            nob_sb_append_cstr(&generated, "//");
+        }
+        nob_sb_append_buf(&generated, line.data, line.count);
+        nob_sb_append_cstr(&generated, "\n");
+    }
+
+    if (nob_file_exists(RAYLIB_CONFIG_PATH) && nob_read_entire_file(RAYLIB_CONFIG_PATH, &existing)
+        && existing.count == generated.count && memcmp(existing.items, generated.items, generated.count) == 0) {
+        nob_return_defer(true);
+    }
+    if (!nob_write_entire_file(RAYLIB_CONFIG_PATH, generated.items, generated.count)) nob_return_defer(false);
+
+defer:
+    nob_sb_free(config);
+    nob_sb_free(generated);
+    nob_sb_free(existing);
+    return result;
+}
+
+// The app's resources get converted into a header linked into the binary, so it starts without
+// decoding the PNG icon or parsing the .pbm mask, and without needing ./resources next to it.
+#define ICON_PATH "./resources/pov-you-wake-up-in-poland.png"
+#define DVD_MASK_PATH "./resources/dvd.pbm"
+#define RESOURCES_HEADER_PATH "./build/resources.h"
+
+// Write the mask in ./resources/dvd.pbm packed the way the app's Grid rows are: bit x % 64 of word
+// x / 64 is set where the pixel is white.
+bool writeDvdMask(Nob_String_Builder *header) {
+    Grid mask;
+    const char *error;
+    if (!pbmLoad(DVD_MASK_PATH, true, NULL, &mask, &error)) {
+        nob_log(NOB_ERROR, "Could not load %s: %s.", DVD_MASK_PATH, error);
+        return false;
+    }
+
+    int rowWords = gridRowWords(&mask);
+    nob_sb_append_cstr(header, nob_temp_sprintf("#define EMBEDDED_DVD_MASK_COLS %d\n", mask.cols));
+    nob_sb_append_cstr(header, nob_temp_sprintf("#define EMBEDDED_DVD_MASK_ROWS %d\n", mask.rows));
+    nob_sb_append_cstr(header, nob_temp_sprintf("#define EMBEDDED_DVD_MASK_ROW_WORDS %d\n", rowWords));
+    nob_sb_append_cstr(header, "static const uint64_t embeddedDvdMask[] = {\n");
+    for (int y = 0; y < mask.rows; y++) {
+        nob_sb_append_cstr(header, "   ");
+        const uint64_t *row = gridRow(&mask, y);
+        for (int w = 0; w < rowWords; w++) {
+            nob_sb_append_cstr(header, nob_temp_sprintf(" 0x%016llxull,", (unsigned long long)row[w]));
+        }
+        nob_sb_append_cstr(header, "\n");
+    }
+    nob_sb_append_cstr(header, "};\n");
+
+    gridFree(&mask);
+    return true;
+}
+
+bool writeIcon(Nob_String_Builder *header) {
+    int width, height, channels;
+    unsigned char *pixels = stbi_load(ICON_PATH, &width, &height, &channels, 4);
+    if (!pixels) {
+        nob_log(NOB_ERROR, "Could not load %s: %s", ICON_PATH, stbi_failure_reason());
+        return false;
+    }
+
+    nob_sb_append_cstr(header, nob_temp_sprintf("#define EMBEDDED_ICON_WIDTH %d\n", width));
+    nob_sb_append_cstr(header, nob_temp_sprintf("#define EMBEDDED_ICON_HEIGHT %d\n", height));
+    nob_sb_append_cstr(header, "// RGBA, 8 bits per channel\n");
+    nob_sb_append_cstr(header, "static const unsigned char embeddedIconPixels[] = {");
+    for (size_t i = 0; i < (size_t)width * height * 4; i++) {
+        nob_sb_append_cstr(header, i % 16 == 0 ? "\n   " : "");
+        nob_sb_append_cstr(header, nob_temp_sprintf(" 0x%02x,", pixels[i]));
+    }
+    nob_sb_append_cstr(header, "\n};\n");
+
+    stbi_image_free(pixels);
+    return true;
+}
+
+bool generateResources(void) {
+    bool result = true;
+
+    // The loaders decide what gets packed, so a change to them regenerates the header too.
+    const char *inputs[] = {ICON_PATH, DVD_MASK_PATH, "./grid.h", "./pbm.h"};
+    int rebuild = nob_needs_rebuild(RESOURCES_HEADER_PATH, inputs, NOB_ARRAY_LEN(inputs));
+    if (rebuild < 0) return false;
+    if (!rebuild) return true;
+
+    size_t checkpoint = nob_temp_save();
+    Nob_String_Builder header = {0};
+    nob_sb_append_cstr(&header, "// Generated by nob.c from ./resources, don't edit.\n\n");
+    nob_sb_append_cstr(&header, "#ifndef RESOURCES_H_\n#define RESOURCES_H_\n\n#include <stdint.h>\n\n");
+    if (!writeIcon(&header)) nob_return_defer(false);
+    nob_sb_append_cstr(&header, "\n");
+    if (!writeDvdMask(&header)) nob_return_defer(false);
+    nob_sb_append_cstr(&header, "\n#endif  // RESOURCES_H_\n");
+
+    nob_log(NOB_INFO, "generating %s", RESOURCES_HEADER_PATH);
+    if (!nob_write_entire_file(RESOURCES_HEADER_PATH, header.items, header.count)) nob_return_defer(false);
+
+defer:
+    nob_temp_rewind(checkpoint);
+    nob_sb_free(header);
+    return result;
+}
+
+// Compiler flags shared by raylib and the app, so link-time optimization can see across both.
+typedef struct {
+    const char *name;
+    const char *flags[8];  // NULL terminated
+    bool lto;
+} BuildProfile;
+
+static const BuildProfile buildProfiles[] = {
+    {"debug", {"-O0", "-g", NULL}, false},
+    {"release", {"-O2", "-flto=auto", NULL}, true},
+    {"release-native", {"-O3", "-march=native", "-flto=auto", NULL}, true},
+};
+
+const BuildProfile *findBuildProfile(const char *name) {
+    for (size_t i = 0; i < NOB_ARRAY_LEN(buildProfiles); i++) {
+        if (strcmp(buildProfiles[i].name, name) == 0) return &buildProfiles[i];
+    }
+    return NULL;
+}
+
+void appendProfileFlags(Nob_Cmd *cmd, const BuildProfile *profile) {
+    for (size_t i = 0; profile->flags[i] != NULL; i++) nob_cmd_append(cmd, profile->flags[i]);
+}
+
+const char *raylibBuildPath(const BuildProfile *profile) {
+    return nob_temp_sprintf("./build/raylib/%s%s", profile->name, stockRaylib ? "-stock" : "");
+}
+
+const char *appOutputPath(bool platformWindows) {
+    return nob_temp_sprintf("./build/pov-brain-is-weird%s%s", stockRaylib ? "-stock" : "", platformWindows ? ".exe" : "");
+}
+
+// Everything gcc saw while building an output, so it gets rebuilt when any header changes and not
+// only its own source file: the depfile written by -MMD lists the sources and headers, and the
+// command line goes to a .cmd file next to the output, so changing flags rebuilds it too.
+const char *depFilePath(const char *outputPath) {
+    return nob_temp_sprintf("%s.d", outputPath);
+}
+
+const char *commandFilePath(const char *outputPath) {
+    return nob_temp_sprintf("%s.cmd", outputPath);
+}
+
+const char *renderCommand(Nob_Cmd cmd) {
+    Nob_String_Builder sb = {0};
+    nob_cmd_render(cmd, &sb);
+    nob_sb_append_null(&sb);
+    const char *command = nob_temp_strdup(sb.items);
+    nob_sb_free(sb);
+    return command;
+}
+
+// Parse the prerequisites of the first rule in a make-style depfile. The paths are unescaped in
+// place and point into `content`, which has to outlive them.
+bool parseDepFile(const char *path, Nob_String_Builder *content, Nob_File_Paths *deps) {
+    if (!nob_file_exists(path)) return false;
+    if (!nob_read_entire_file(path, content)) return false;
+    nob_sb_append_null(content);
+
+    char *text = content->items;
+    size_t count = content->count - 1;
+
+    // The target ends at the first colon followed by whitespace, so drive letters don't count.
+    size_t i = 0;
+    while (i < count && !(text[i] == ':' && (i + 1 == count || isspace((unsigned char)text[i + 1])))) i++;
+    if (i == count) {
+        nob_log(NOB_ERROR, "%s is not a depfile", path);
+        return false;
+    }
+    i++;
+
+    for (;;) {
+        // Skip whitespace and line continuations, an unescaped newline ends the rule.
+        while (i < count) {
+            if (text[i] == ' ' || text[i] == '\t' || text[i] == '\r') {
+                i++;
+            } else if (text[i] == '\\' && i + 1 < count && (text[i + 1] == '\n' || text[i + 1] == '\r')) {
+                i += 2;
+                if (i < count && text[i - 1] == '\r' && text[i] == '\n') i++;
+            } else {
+                break;
+            }
+        }
+        if (i == count || text[i] == '\n') break;
+
+        char *dep = &text[i];
+        size_t length = 0;
+        while (i < count && !isspace((unsigned char)text[i])) {
+            if (text[i] == '\\' && i + 1 < count && (text[i + 1] == ' ' || text[i + 1] == '#')) {
+                i++;
+            } else if (text[i] == '$' && i + 1 < count && text[i + 1] == '$') {
+                i++;
+            } else if (text[i] == '\\' && i + 1 < count && (text[i + 1] == '\n' || text[i + 1] == '\r')) {
+                break;
+            }
+            dep[length++] = text[i++];
+        }
+        // Can't clobber the separator before looking at it.
+        bool endOfRule = i == count || text[i] == '\n';
+        dep[length] = '\0';
+        nob_da_append(deps, dep);
+        if (endOfRule) break;
+        i++;
+    }
+
+    return true;
+}
+
+// Like nob_needs_rebuild(), but the inputs are the ones from the depfile of `outputPath` plus
+// `extraInputs` (for what the depfile doesn't list, like libraries), and a different command line
+// than last time counts as out of date as well. So does a depfile input that can't be stat'd, as in
+// make and ninja: a header that has since been deleted or renamed just means the object is stale,
+// and if the source itself is gone the compile reports it.
+int needsRebuildTracked(const char *outputPath, const char *command, const char **extraInputs, size_t extraCount) {
+    int result = 0;
+    Nob_String_Builder recorded = {0};
+    Nob_String_Builder depContent = {0};
+    Nob_File_Paths inputs = {0};
+
+    if (!nob_file_exists(outputPath)) nob_return_defer(1);
+
+    const char *commandPath = commandFilePath(outputPath);
+    if (!nob_file_exists(commandPath) || !nob_read_entire_file(commandPath, &recorded)) nob_return_defer(1);
+    if (recorded.count != strlen(command) || memcmp(recorded.items, command, recorded.count) != 0) nob_return_defer(1);
+
+    if (!parseDepFile(depFilePath(outputPath), &depContent, &inputs)) nob_return_defer(1);
+    for (size_t i = 0; i < inputs.count; i++) {
+        if (nob_file_exists(inputs.items[i]) != 1) nob_return_defer(1);
+    }
+    nob_da_append_many(&inputs, extraInputs, extraCount);
+    result = nob_needs_rebuild(outputPath, inputs.items, inputs.count);
+
+defer:
+    nob_sb_free(recorded);
+    nob_sb_free(depContent);
+    nob_da_free(inputs);
+    return result;
+}
+
+// Call right before running `command`: without a record, a build that fails or gets interrupted is
+// retried next time even if it left an output behind.
+void forgetCommand(const char *outputPath) {
+    remove(commandFilePath(outputPath));
+}
+
+// Call once `command` built `outputPath` successfully.
+bool recordCommand(const char *outputPath, const char *command) {
+    return nob_write_entire_file(commandFilePath(outputPath), command, strlen(command));
+}
+
+// Compiled raylib objects are also kept in a cache keyed on a hash of their preprocessed source
+// and the compiler flags, so a fresh checkout, a wiped build directory or switching back to a profile
+// only has to preprocess the modules to get them back. The preprocessed source is dumped with -dD,
+// which includes the predefined macros, so the compiler version and target features (say, with
+// -march=native) are part of the key as well. Every flag or compiler change adds a new set of
+// entries, so once the cache goes over CACHE_MAX_BYTES the least recently used ones are evicted (an
+// entry's modification time is bumped whenever it's restored), and `./nob clean-cache` empties it.
+#define CACHE_PATH "./build/cache"
+#define CACHE_MAX_BYTES (256ll * 1024 * 1024)  // a pruned release build of raylib takes ~8 MiB
+
+typedef struct {
+    const char *outputPath;
+    const char *command;    // recorded once the object is built
+    const char *cachePath;  // NULL if the object doesn't go in the cache
+} ObjectBuild;
+
+typedef struct {
+    ObjectBuild *items;
+    size_t count;
+    size_t capacity;
+} ObjectBuilds;
+
+// Profile data changes what gets compiled without touching the source, so those builds stay out.
+bool profileIsCacheable(const BuildProfile *profile) {
+    for (size_t i = 0; profile->flags[i] != NULL; i++) {
+        if (strncmp(profile->flags[i], "-fprofile-", strlen("-fprofile-")) == 0) return false;
+    }
+    return true;
+}
+
+uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+// Cache entry for an object compiled with `flags` from the preprocessed source at `preprocessedPath`.
+const char *cachePathFor(const char *flags, const char *preprocessedPath) {
+    Nob_String_Builder source = {0};
+    if (!nob_read_entire_file(preprocessedPath, &source)) return NULL;
+
+    uint64_t hash = 0xcbf29ce484222325;
+    hash = fnv1a(hash, flags, strlen(flags) + 1);
+    hash = fnv1a(hash, source.items, source.count);
+    nob_sb_free(source);
+
+    return nob_temp_sprintf("%s/%016llx.o", CACHE_PATH, (unsigned long long)hash);
+}
+
+typedef struct {
+    const char *path;
+    long long size;
+    time_t modified;
+} CacheEntry;
+
+typedef struct {
+    CacheEntry *items;
+    size_t count;
+    size_t capacity;
+} CacheEntries;
+
+int compareCacheEntries(const void *a, const void *b) {
+    time_t x = ((const CacheEntry *)a)->modified;
+    time_t y = ((const CacheEntry *)b)->modified;
+    return (x > y) - (x < y);
+}
+
+// Remove the entries of the cache that were written or restored the longest ago until the rest fit
+// in `maxBytes`, so 0 removes all of them.
+bool trimCache(long long maxBytes) {
+    bool result = true;
+
+    Nob_File_Paths children = {0};
+    CacheEntries entries = {0};
+    if (!nob_file_exists(CACHE_PATH)) nob_return_defer(true);
+    if (!nob_read_entire_dir(CACHE_PATH, &children)) nob_return_defer(false);
+
+    long long total = 0;
+    for (size_t i = 0; i < children.count; i++) {
+        const char *name = children.items[i];
+        size_t length = strlen(name);
+        if (length < 2 || strcmp(name + length - 2, ".o") != 0) continue;
+
+        CacheEntry entry = {.path = nob_temp_sprintf("%s/%s", CACHE_PATH, name)};
+        struct stat info;
+        if (stat(entry.path, &info) != 0) {
+            nob_log(NOB_ERROR, "Could not stat %s: %s", entry.path, strerror(errno));
+            nob_return_defer(false);
+        }
+        entry.size = info.st_size;
+        entry.modified = info.st_mtime;
+        total += entry.size;
+        nob_da_append(&entries, entry);
+    }
+
+    qsort(entries.items, entries.count, sizeof(CacheEntry), compareCacheEntries);
+    size_t evicted = 0;
+    for (; evicted < entries.count && total > maxBytes; evicted++) {
+        if (remove(entries.items[evicted].path) != 0) {
+            nob_log(NOB_ERROR, "Could not remove %s: %s", entries.items[evicted].path, strerror(errno));
+            nob_return_defer(false);
+        }
+        total -= entries.items[evicted].size;
+    }
+    if (evicted > 0) nob_log(NOB_INFO, "removed %zu objects from %s, %lld KiB left", evicted, CACHE_PATH, total / 1024);
+
+defer:
+    nob_da_free(children);
+    nob_da_free(entries);
+    return result;
+}
+
+bool buildRaylib(const BuildProfile *profile) {
     bool result = true;
 
+    Nob_Cmd flags = {0};
     Nob_Cmd cmd = {0};
     Nob_File_Paths objectFiles = {0};
-    Nob_Procs procs = {0};
+    ObjectBuilds candidates = {0};  // objects that might be in the cache
+    ObjectBuilds builds = {0};      // objects that have to be compiled, one per compile job
+    Nob_Jobs preprocessJobs = {.max_parallelism = maxParallelJobs};
+    Nob_Jobs candidateJobs = {0};
+    Nob_Jobs compileJobs = {.max_parallelism = maxParallelJobs};
 
     if (!nob_mkdir_if_not_exists("./build/raylib")) nob_return_defer(false);
+    if (!stockRaylib && !generateRaylibConfig()) nob_return_defer(false);
 
-    const char *buildPath = "./build/raylib/gcc";
+    const char *buildPath = raylibBuildPath(profile);
     if (!nob_mkdir_if_not_exists(buildPath)) nob_return_defer(false);
 
+    bool cacheable = profileIsCacheable(profile);
+    if (cacheable && !nob_mkdir_if_not_exists(CACHE_PATH)) nob_return_defer(false);
+
+    nob_cmd_append(&flags, "gcc");
+    nob_cmd_append(&flags, "-DPLATFORM_DESKTOP", "-fPIC");
+    appendProfileFlags(&flags, profile);
+    nob_cmd_append(&flags, "-I./raylib/raylib-5.0/src/external/glfw/include");
+    if (!stockRaylib) nob_cmd_append(&flags, "-DEXTERNAL_CONFIG_FLAGS", "-include", RAYLIB_CONFIG_PATH);
+    const char *renderedFlags = renderCommand(flags);
+
     for (size_t i = 0; i < NOB_ARRAY_LEN(raylibModules); i++) {
+        if (!stockRaylib && isListed(nob_sv_from_cstr(raylibModules[i]), unusedRaylibModules, NOB_ARRAY_LEN(unusedRaylibModules))) continue;
+
         const char *inputPath = nob_temp_sprintf("./raylib/raylib-5.0/src/%s.c", raylibModules[i]);
         const char *outputPath = nob_temp_sprintf("%s/%s.o", buildPath, raylibModules[i]);
 
         nob_da_append(&objectFiles, outputPath);
 
-        if (nob_needs_rebuild(outputPath, &inputPath, 1)) {
+        cmd.count = 0;
+        nob_da_append_many(&cmd, flags.items, flags.count);
+        nob_cmd_append(&cmd, "-MMD", "-MF", depFilePath(outputPath));
+        nob_cmd_append(&cmd, "-c", inputPath);
+        nob_cmd_append(&cmd, "-o", outputPath);
+
+        const char *command = renderCommand(cmd);
+        int rebuild = needsRebuildTracked(outputPath, command, NULL, 0);
+        if (rebuild < 0) nob_return_defer(false);
+        if (!rebuild) continue;
+
+        forgetCommand(outputPath);
+        ObjectBuild build = {.outputPath = outputPath, .command = command};
+        if (!cacheable) {
+            nob_jobs_append(&compileJobs, outputPath, cmd);
+            nob_da_append(&builds, build);
+        } else {
+            // Compiled later, if the cache doesn't have it.
+            nob_jobs_append(&candidateJobs, outputPath, cmd);
+            nob_da_append(&candidates, build);
+
+            // Writes the same depfile as compiling would, so a cache hit is tracked like any other build.
             cmd.count = 0;
-            nob_cmd_append(&cmd, "gcc");
-            nob_cmd_append(&cmd, "-DPLATFORM_DESKTOP", "-fPIC");
-            nob_cmd_append(&cmd, "-I./raylib/raylib-5.0/src/external/glfw/include");
-            nob_cmd_append(&cmd, "-c", inputPath);
-            nob_cmd_append(&cmd, "-o", outputPath);
-
-            Nob_Proc proc = nob_cmd_run_async(cmd);
-            nob_da_append(&procs, proc);
+            nob_da_append_many(&cmd, flags.items, flags.count);
+            nob_cmd_append(&cmd, "-E", "-dD");
+            nob_cmd_append(&cmd, "-MMD", "-MF", depFilePath(outputPath), "-MT", outputPath);
+            nob_cmd_append(&cmd, inputPath);
+            nob_cmd_append(&cmd, "-o", nob_temp_sprintf("%s.i", outputPath));
+            nob_jobs_append(&preprocessJobs, outputPath, cmd);
         }
     }
-    if (!nob_procs_wait(procs)) nob_return_defer(false);
+
+    if (preprocessJobs.count > 0) {
+        if (!nob_jobs_run(&preprocessJobs)) result = false;
+
+        for (size_t i = 0; i < candidates.count; i++) {
+            if (!preprocessJobs.items[i].ok) continue;
+
+            ObjectBuild build = candidates.items[i];
+            const char *preprocessedPath = nob_temp_sprintf("%s.i", build.outputPath);
+            build.cachePath = cachePathFor(renderedFlags, preprocessedPath);
+            remove(preprocessedPath);
+            if (!build.cachePath) {
+                result = false;
+                continue;
+            }
+
+            if (nob_file_exists(build.cachePath)) {
+                nob_log(NOB_INFO, "%s: restored from %s", build.outputPath, build.cachePath);
+                if (!nob_copy_file(build.cachePath, build.outputPath) || !recordCommand(build.outputPath, build.command)) {
+                    result = false;
+                }
+                // Mark the entry as just used, so trimCache() keeps it over ones nothing restores.
+                if (utime(build.cachePath, NULL) != 0) {
+                    nob_log(NOB_WARNING, "Could not touch %s: %s", build.cachePath, strerror(errno));
+                }
+                continue;
+            }
+
+            nob_jobs_append(&compileJobs, build.outputPath, candidateJobs.items[i].cmd);
+            nob_da_append(&builds, build);
+        }
+    }
+
+    if (!nob_jobs_run(&compileJobs)) result = false;
+    // Record every module that built, so one broken module doesn't get all the others rebuilt.
+    for (size_t i = 0; i < compileJobs.count; i++) {
+        if (!compileJobs.items[i].ok) continue;
+
+        ObjectBuild build = builds.items[i];
+        if (!recordCommand(build.outputPath, build.command)) result = false;
+        if (build.cachePath && !nob_copy_file(build.outputPath, build.cachePath)) {
+            nob_log(NOB_WARNING, "Could not cache %s, it will be compiled again next time", build.outputPath);
+        }
+    }
+    if (!result) nob_return_defer(false);
+    if (cacheable && compileJobs.count > 0 && !trimCache(CACHE_MAX_BYTES)) nob_return_defer(false);
 
     cmd.count = 0;
 
     const char *libraylibPath = nob_temp_sprintf("%s/libraylib.a", buildPath);
 
     if (nob_needs_rebuild(libraylibPath, objectFiles.items, objectFiles.count)) {
-        nob_cmd_append(&cmd, "ar", "-crs", libraylibPath);
-        for (size_t i = 0; i < NOB_ARRAY_LEN(raylibModules); ++i) {
-            const char *inputPath = nob_temp_sprintf("%s/%s.o", buildPath, raylibModules[i]);
-            nob_cmd_append(&cmd, inputPath);
-        }
+        // ar only adds and replaces members, so start over to get rid of modules that were pruned.
+        remove(libraylibPath);
+        // The LTO objects only hold GIMPLE, gcc-ar adds the symbol index for them through the plugin.
+        nob_cmd_append(&cmd, profile->lto ? "gcc-ar" : "ar", "-crs", libraylibPath);
+        nob_da_append_many(&cmd, objectFiles.items, objectFiles.count);
         if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
     }
 
 defer:
+    nob_cmd_free(flags);
     nob_cmd_free(cmd);
     nob_da_free(objectFiles);
-    nob_da_free(procs);
+    nob_da_free(candidates);
+    nob_da_free(builds);
+    nob_jobs_free(&preprocessJobs);
+    nob_jobs_free(&candidateJobs);
+    nob_jobs_free(&compileJobs);
     return result;
 }
 
-bool buildPovBrainIsWeird(bool platformWindows) {
+bool buildPovBrainIsWeird(const BuildProfile *profile, bool platformWindows) {
     bool result = true;
 
+    // Spelled out with .exe so the up-to-date check finds the binary gcc actually writes.
+    const char *outputPath = appOutputPath(platformWindows);
+    const char *libraylibPath = nob_temp_sprintf("%s/libraylib.a", raylibBuildPath(profile));
+
     Nob_Cmd cmd = {0};
     nob_cmd_append(&cmd, "gcc");
 
     if (platformWindows) nob_cmd_append(&cmd, "-mwindows");
 
     nob_cmd_append(&cmd, "-Wall", "-Wextra");
+    appendProfileFlags(&cmd, profile);
     nob_cmd_append(&cmd, "-I./build/");
     nob_cmd_append(&cmd, "-I./raylib/raylib-5.0/src/");
-    nob_cmd_append(&cmd, "-o", "./build/pov-brain-is-weird");
+    nob_cmd_append(&cmd, "-MMD", "-MF", depFilePath(outputPath));
+    nob_cmd_append(&cmd, "-o", outputPath);
     nob_cmd_append(&cmd, "./pov-brain-is-weird.c");
-    nob_cmd_append(&cmd, "-L./build/raylib/gcc");
+    nob_cmd_append(&cmd, nob_temp_sprintf("-L%s", raylibBuildPath(profile)));
     nob_cmd_append(&cmd, "-l:libraylib.a");
     nob_cmd_append(&cmd, "-lm");  // needed on Linux, doesn't cause issues on Windows
+    nob_cmd_append(&cmd, "-pthread");  // for the worker pool in workers.h
 
     if (platformWindows) {
         nob_cmd_append(&cmd, "-lwinmm", "-lgdi32");
         nob_cmd_append(&cmd, "-static");
     }
 
+    const char *command = renderCommand(cmd);
+    int rebuild = needsRebuildTracked(outputPath, command, &libraylibPath, 1);
+    if (rebuild < 0) nob_return_defer(false);
+    if (rebuild == 0) {
+        nob_log(NOB_INFO, "%s is up to date", outputPath);
+        nob_return_defer(true);
+    }
+
+    forgetCommand(outputPath);
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+    if (!recordCommand(outputPath, command)) nob_return_defer(false);
+
+defer:
+    nob_cmd_free(cmd);
+    return result;
+}
+
+// The benchmarks only exercise the grid kernels, so they don't need raylib at all.
+bool buildAndRunBench(const BuildProfile *profile) {
+    bool result = true;
+
+    Nob_Cmd cmd = {0};
+    nob_cmd_append(&cmd, "gcc");
+    nob_cmd_append(&cmd, "-Wall", "-Wextra");
+    appendProfileFlags(&cmd, profile);
+    nob_cmd_append(&cmd, "-o", "./build/bench");
+    nob_cmd_append(&cmd, "./bench.c");
+    nob_cmd_append(&cmd, "-lm", "-pthread");
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+    cmd.count = 0;
+    nob_cmd_append(&cmd, "./build/bench", "-o", "./build/bench.csv");
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+defer:
+    nob_cmd_free(cmd);
+    return result;
+}
+
+// Scripted sessions for training PGO builds: every simulation for a while, with a fixed seed so the
+// profile is the same from one run to the next. The headless one runs anywhere but never draws, so
+// only -pgo-window, which needs a display, gets rendering and raylib's drawing code a profile.
+static const char *pgoTrainingArgs[] = {"-headless", "lines,clock,dvd", "-frames", "3600", "-seed", "1"};
+static const char *pgoWindowTrainingArgs[] = {"-script", "lines,clock,dvd,life", "-frames", "600", "-seed", "1"};
+
+#define PGO_DATA_PATH "./build/pgo"
+
+// `profile` extended with `extraFlags`, under the name "pgo". Both PGO stages have to build into the
+// same paths, since the profile of an object file is looked up by its path.
+BuildProfile pgoProfile(const BuildProfile *profile, const char *extraFlags[], size_t extraCount) {
+    BuildProfile result = {.name = "pgo", .lto = profile->lto};
+    size_t count = 0;
+    for (size_t i = 0; profile->flags[i] != NULL; i++) result.flags[count++] = profile->flags[i];
+    for (size_t i = 0; i < extraCount; i++) result.flags[count++] = extraFlags[i];
+    NOB_ASSERT(count < NOB_ARRAY_LEN(result.flags) && "Too many flags for a PGO build profile");
+    return result;
+}
+
+// Remove the counters of a previous training run, they don't match freshly instrumented code. gcc
+// writes them all straight into the directory, each named after its object's path with the slashes
+// mangled to '#' (e.g. `#root#repo#build#obj#rcore.gcda`).
+bool removeProfileData(const char *dirPath) {
+    bool result = true;
+
+    Nob_File_Paths children = {0};
+    if (!nob_read_entire_dir(dirPath, &children)) nob_return_defer(false);
+    for (size_t i = 0; i < children.count; i++) {
+        const char *name = children.items[i];
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+
+        size_t length = strlen(name);
+        if (length < 5 || strcmp(name + length - 5, ".gcda") != 0) continue;
+        const char *path = nob_temp_sprintf("%s/%s", dirPath, name);
+        if (remove(path) != 0) {
+            nob_log(NOB_ERROR, "Could not remove %s: %s", path, strerror(errno));
+            nob_return_defer(false);
+        }
+    }
+
+defer:
+    nob_da_free(children);
+    return result;
+}
+
+// Build an instrumented binary, train it with one of the scripted sessions and rebuild everything
+// with the profile it recorded. Code the session never runs (e.g. drawing, unless `window`) is
+// optimized as usual rather than as cold, thanks to -fprofile-partial-training.
+bool buildWithPgo(const BuildProfile *profile, bool platformWindows, bool window) {
+    bool result = true;
+    Nob_Cmd cmd = {0};
+
+    if (!nob_mkdir_if_not_exists(PGO_DATA_PATH)) nob_return_defer(false);
+    if (!removeProfileData(PGO_DATA_PATH)) nob_return_defer(false);
+
+    const char *generateFlags[] = {"-fprofile-generate=" PGO_DATA_PATH, "-fprofile-update=atomic"};
+    BuildProfile generate = pgoProfile(profile, generateFlags, NOB_ARRAY_LEN(generateFlags));
+    if (!buildRaylib(&generate)) nob_return_defer(false);
+    if (!buildPovBrainIsWeird(&generate, platformWindows)) nob_return_defer(false);
+
+    nob_cmd_append(&cmd, appOutputPath(platformWindows));
+    if (window) {
+        nob_da_append_many(&cmd, pgoWindowTrainingArgs, NOB_ARRAY_LEN(pgoWindowTrainingArgs));
+    } else {
+        nob_log(NOB_WARNING, "Training without a window, rendering won't be profiled. Pass -pgo-window to include it.");
+        nob_da_append_many(&cmd, pgoTrainingArgs, NOB_ARRAY_LEN(pgoTrainingArgs));
+    }
     if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
 
+    const char *useFlags[] = {"-fprofile-use=" PGO_DATA_PATH, "-fprofile-partial-training", "-Wno-missing-profile"};
+    BuildProfile use = pgoProfile(profile, useFlags, NOB_ARRAY_LEN(useFlags));
+    if (!buildRaylib(&use)) nob_return_defer(false);
+    if (!buildPovBrainIsWeird(&use, platformWindows)) nob_return_defer(false);
+
 defer:
     nob_cmd_free(cmd);
     return result;
 }
 
+// Size in bytes of the file at `path`, or -1 if it can't be read.
+long fileSize(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return -1;
+    long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    fclose(file);
+    return size;
+}
+
+// Build the app against both stock and pruned raylib and compare the size of the binaries. Startup
+// time isn't reported: a headless run never initializes raylib, so it would time the same code twice.
+bool reportRaylibPruning(const BuildProfile *profile, bool platformWindows) {
+    bool result = true;
+
+    const char *variants[] = {"stock", "pruned"};
+    long sizes[2];
+    for (size_t v = 0; v < 2; v++) {
+        stockRaylib = v == 0;
+        if (!buildRaylib(profile)) nob_return_defer(false);
+        if (!buildPovBrainIsWeird(profile, platformWindows)) nob_return_defer(false);
+
+        const char *appPath = appOutputPath(platformWindows);
+        sizes[v] = fileSize(appPath);
+        if (sizes[v] < 0) {
+            nob_log(NOB_ERROR, "Could not read the size of %s", appPath);
+            nob_return_defer(false);
+        }
+    }
+
+    for (size_t v = 0; v < 2; v++) {
+        nob_log(NOB_INFO, "%-6s raylib: %8.1f KiB", variants[v], sizes[v] / 1024.0);
+    }
+    nob_log(NOB_INFO, "pruning saves %.1f KiB", (sizes[0] - sizes[1]) / 1024.0);
+
+defer:
+    stockRaylib = false;
+    return result;
+}
+
 void print_usage(void) {
-    nob_log(NOB_INFO, "usage: [./]nob [-platform] [platform]");
+    nob_log(NOB_INFO, "usage: [./]nob [bench|pgo|size-report|clean-cache] [-platform] [platform] [-profile] [profile] [-j] [jobs] [-stock-raylib] [-pgo-window]");
     nob_log(NOB_INFO, "platforms supported: windows, linux");
+    nob_log(NOB_INFO, "profiles supported: debug (-O0 -g), release (-O2 with LTO, the default), release-native (-O3 -march=native with LTO)");
+    nob_log(NOB_INFO, "jobs: how many compiles run in parallel, one per CPU by default");
+    nob_log(NOB_INFO, "bench: build the grid kernel benchmarks and write their results to ./build/bench.csv");
+    nob_log(NOB_INFO, "-stock-raylib: build all of raylib with its own config.h instead of only what the app uses");
+    nob_log(NOB_INFO, "size-report: build against stock and pruned raylib and compare binary size");
+    nob_log(NOB_INFO, "clean-cache: remove every compiled raylib object cached in " CACHE_PATH);
+    nob_log(NOB_INFO, "pgo: build with profile-guided optimization, trained on a headless run of every simulation, which leaves rendering unprofiled");
+    nob_log(NOB_INFO, "-pgo-window: train pgo on a scripted run in a window instead, so rendering is profiled too (needs a display)");
 }
 
 int main(int argc, char **argv) {
-    NOB_GO_REBUILD_URSELF(argc, argv);
+    // The headers shared with the app are compiled into nob as well.
+    NOB_GO_REBUILD_URSELF_PLUS(argc, argv, "./grid.h", "./workers.h", "./pbm.h");
+
+    nob_shift_args(&argc, &argv);
 
     bool platformWindows = true;
-    if (argc != 1) {
-        if (strcmp(argv[1], "-platform") == 0) {
-            if (strcmp(argv[2], "linux") == 0) {
+    bool bench = false;
+    bool pgo = false;
+    bool pgoWindow = false;
+    bool sizeReport = false;
+    bool cleanCache = false;
+    const BuildProfile *profile = findBuildProfile("release");
+    while (argc > 0) {
+        const char *arg = nob_shift_args(&argc, &argv);
+        if (strcmp(arg, "bench") == 0) {
+            bench = true;
+        } else if (strcmp(arg, "pgo") == 0) {
+            pgo = true;
+        } else if (strcmp(arg, "size-report") == 0) {
+            sizeReport = true;
+        } else if (strcmp(arg, "clean-cache") == 0) {
+            cleanCache = true;
+        } else if (strcmp(arg, "-stock-raylib") == 0) {
+            stockRaylib = true;
+        } else if (strcmp(arg, "-pgo-window") == 0) {
+            pgoWindow = true;
+        } else if (strcmp(arg, "-platform") == 0 && argc > 0) {
+            const char *platform = nob_shift_args(&argc, &argv);
+            if (strcmp(platform, "linux") == 0) {
                 platformWindows = false;
-            } else if (strcmp(argv[2], "windows") == 0) {
+            } else if (strcmp(platform, "windows") == 0) {
                 platformWindows = true;
             } else {
                 nob_log(NOB_ERROR, "unsupported platform\n");
                 print_usage();
                 return 1;
             }
+        } else if (strcmp(arg, "-j") == 0 && argc > 0) {
+            const char *jobs = nob_shift_args(&argc, &argv);
+            char *end;
+            long parsed = strtol(jobs, &end, 10);
+            if (*end != '\0' || parsed <= 0) {
+                nob_log(NOB_ERROR, "-j expects a positive number of jobs, got %s", jobs);
+                print_usage();
+                return 1;
+            }
+            maxParallelJobs = parsed;
+        } else if (strcmp(arg, "-profile") == 0 && argc > 0) {
+            const char *name = nob_shift_args(&argc, &argv);
+            profile = findBuildProfile(name);
+            if (!profile) {
+                nob_log(NOB_ERROR, "unsupported profile %s", name);
+                print_usage();
+                return 1;
+            }
         } else {
             print_usage();
             return 1;
@@ -121,8 +884,16 @@ int main(int argc, char **argv) {
 
     if (!nob_mkdir_if_not_exists("build")) return 1;
 
-    if (!buildRaylib()) return 1;
-    if (!buildPovBrainIsWeird(platformWindows)) return 1;
+    if (bench) return buildAndRunBench(profile) ? 0 : 1;
+    if (cleanCache) return trimCache(0) ? 0 : 1;
+
+    if (!generateResources()) return 1;
+
+    if (sizeReport) return reportRaylibPruning(profile, platformWindows) ? 0 : 1;
+    if (pgo) return buildWithPgo(profile, platformWindows, pgoWindow) ? 0 : 1;
+
+    if (!buildRaylib(profile)) return 1;
+    if (!buildPovBrainIsWeird(profile, platformWindows)) return 1;
 
     return 0;
 }
@@ -38,6 +38,7 @@
 #include <string.h>
 #include <errno.h>
 #include <ctype.h>
+#include <time.h>
 
 #ifdef _WIN32
 #    define WIN32_LEAN_AND_MEAN
@@ -180,6 +181,12 @@ bool nob_procs_wait(Nob_Procs procs);
 // Wait until the process has finished
 bool nob_proc_wait(Nob_Proc proc);
 
+// Number of CPUs currently online, at least 1
+size_t nob_nprocs(void);
+
+// Monotonic clock in seconds, for timing things
+double nob_now_seconds(void);
+
 // A command - the main workhorse of Nob. Nob is all about building commands an running them
 typedef struct {
     const char **items;
@@ -198,6 +205,37 @@ void nob_cmd_render(Nob_Cmd cmd, Nob_String_Builder *render);
 // Free all the memory allocated by command arguments
 #define nob_cmd_free(cmd) NOB_FREE(cmd.items)
 
+// A command queued in a job pool, and how it went once it's done
+typedef struct {
+    const char *name;
+    Nob_Cmd cmd;
+    Nob_Proc proc;
+    double started_at;
+    double seconds;
+    bool ok;
+} Nob_Job;
+
+// A pool of commands run in parallel, but never more than max_parallelism at a time (the number
+// of online CPUs if 0). The next job starts as soon as any running one finishes, instead of waiting
+// for them in order, and every job's wall time gets logged.
+typedef struct {
+    Nob_Job *items;
+    size_t count;
+    size_t capacity;
+    size_t max_parallelism;
+} Nob_Jobs;
+
+// Queue a command. The argument array is copied, the strings it points to are not.
+void nob_jobs_append(Nob_Jobs *jobs, const char *name, Nob_Cmd cmd);
+
+// Run all the queued jobs and wait for them. After the first failure no new jobs are started, but
+// the running ones are still waited for. Returns true if all of them succeeded; the ok field of each
+// job tells which ones did.
+bool nob_jobs_run(Nob_Jobs *jobs);
+
+// Free the memory allocated by a job pool
+void nob_jobs_free(Nob_Jobs *jobs);
+
 // Run command asynchronously
 Nob_Proc nob_cmd_run_async(Nob_Cmd cmd);
 
@@ -257,13 +295,20 @@ int nob_file_exists(const char *file_path);
 //   do not recommend since the whole idea of nobuild is to keep the process of bootstrapping
 //   as simple as possible and doing all of the actual work inside of the nobuild)
 //
-#define NOB_GO_REBUILD_URSELF(argc, argv)                                                    \
+//   If the build system includes other files of yours, list them after argv with
+//   GO_REBUILD_URSELF_PLUS(argc, argv, "foo.h", "bar.h") so changing them rebuilds it too.
+//
+#define NOB_GO_REBUILD_URSELF(argc, argv) NOB_GO_REBUILD_URSELF_PLUS(argc, argv, __FILE__)
+
+#define NOB_GO_REBUILD_URSELF_PLUS(argc, argv, ...)                                          \
     do {                                                                                     \
-        const char *source_path = __FILE__;                                                  \
+        const char *source_paths[] = {__FILE__, __VA_ARGS__};                                \
+        const char *source_path = source_paths[0];                                           \
         assert(argc >= 1);                                                                   \
         const char *binary_path = argv[0];                                                   \
                                                                                              \
-        int rebuild_is_needed = nob_needs_rebuild(binary_path, &source_path, 1);             \
+        int rebuild_is_needed = nob_needs_rebuild(binary_path, source_paths,                 \
+                                                  NOB_ARRAY_LEN(source_paths));              \
         if (rebuild_is_needed < 0) exit(1);                                                  \
         if (rebuild_is_needed) {                                                             \
             Nob_String_Builder sb = {0};                                                     \
@@ -612,6 +657,158 @@ bool nob_proc_wait(Nob_Proc proc)
 #endif
 }
 
+size_t nob_nprocs(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t) count : 1;
+#endif
+}
+
+double nob_now_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double) counter.QuadPart / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+void nob_jobs_append(Nob_Jobs *jobs, const char *name, Nob_Cmd cmd)
+{
+    Nob_Job job = {0};
+    job.name = name;
+    job.proc = NOB_INVALID_PROC;
+    nob_da_append_many(&job.cmd, cmd.items, cmd.count);
+    nob_da_append(jobs, job);
+}
+
+// Wait for any of the running jobs to finish and return its index, or jobs->count on failure
+static size_t nob__jobs_wait_any(Nob_Jobs *jobs)
+{
+#ifdef _WIN32
+    HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+    size_t indices[MAXIMUM_WAIT_OBJECTS];
+    DWORD count = 0;
+    for (size_t i = 0; i < jobs->count; ++i) {
+        if (jobs->items[i].proc != NOB_INVALID_PROC) {
+            handles[count] = jobs->items[i].proc;
+            indices[count] = i;
+            count += 1;
+        }
+    }
+
+    DWORD result = WaitForMultipleObjects(count, handles, FALSE, INFINITE);
+    if (result >= WAIT_OBJECT_0 + count) {
+        nob_log(NOB_ERROR, "could not wait on child processes: %lu", GetLastError());
+        return jobs->count;
+    }
+
+    Nob_Job *job = &jobs->items[indices[result - WAIT_OBJECT_0]];
+    DWORD exit_status;
+    if (!GetExitCodeProcess(job->proc, &exit_status)) {
+        nob_log(NOB_ERROR, "could not get process exit code: %lu", GetLastError());
+        job->ok = false;
+    } else if (exit_status != 0) {
+        nob_log(NOB_ERROR, "%s: command exited with exit code %lu", job->name, exit_status);
+        job->ok = false;
+    } else {
+        job->ok = true;
+    }
+    CloseHandle(job->proc);
+    job->proc = NOB_INVALID_PROC;
+    return indices[result - WAIT_OBJECT_0];
+#else
+    for (;;) {
+        int wstatus = 0;
+        pid_t pid = waitpid(-1, &wstatus, 0);
+        if (pid < 0) {
+            nob_log(NOB_ERROR, "could not wait on child processes: %s", strerror(errno));
+            return jobs->count;
+        }
+        if (!WIFEXITED(wstatus) && !WIFSIGNALED(wstatus)) continue;
+
+        for (size_t i = 0; i < jobs->count; ++i) {
+            Nob_Job *job = &jobs->items[i];
+            if (job->proc != pid) continue;
+
+            if (WIFSIGNALED(wstatus)) {
+                nob_log(NOB_ERROR, "%s: command process was terminated by %s", job->name, strsignal(WTERMSIG(wstatus)));
+                job->ok = false;
+            } else if (WEXITSTATUS(wstatus) != 0) {
+                nob_log(NOB_ERROR, "%s: command exited with exit code %d", job->name, WEXITSTATUS(wstatus));
+                job->ok = false;
+            } else {
+                job->ok = true;
+            }
+            job->proc = NOB_INVALID_PROC;
+            return i;
+        }
+        // Not one of ours, somebody else's child that happened to finish.
+    }
+#endif
+}
+
+bool nob_jobs_run(Nob_Jobs *jobs)
+{
+    if (jobs->count == 0) return true;
+
+    size_t max_parallelism = jobs->max_parallelism > 0 ? jobs->max_parallelism : nob_nprocs();
+#ifdef _WIN32
+    if (max_parallelism > MAXIMUM_WAIT_OBJECTS) max_parallelism = MAXIMUM_WAIT_OBJECTS;
+#endif
+
+    bool success = true;
+    size_t next = 0;
+    size_t running = 0;
+    size_t finished = 0;
+    double started_at = nob_now_seconds();
+    while (running > 0 || (success && next < jobs->count)) {
+        while (success && next < jobs->count && running < max_parallelism) {
+            Nob_Job *job = &jobs->items[next++];
+            job->started_at = nob_now_seconds();
+            job->proc = nob_cmd_run_async(job->cmd);
+            if (job->proc == NOB_INVALID_PROC) {
+                success = false;
+                break;
+            }
+            running += 1;
+        }
+        if (running == 0) break;
+
+        size_t i = nob__jobs_wait_any(jobs);
+        if (i == jobs->count) return false;
+
+        Nob_Job *job = &jobs->items[i];
+        job->seconds = nob_now_seconds() - job->started_at;
+        running -= 1;
+        finished += 1;
+        success = job->ok && success;
+        nob_log(NOB_INFO, "[%zu/%zu] %s: %.2fs", finished, jobs->count, job->name, job->seconds);
+    }
+
+    nob_log(NOB_INFO, "%zu jobs in %.2fs, %zu at a time", finished, nob_now_seconds() - started_at, max_parallelism);
+    return success;
+}
+
+void nob_jobs_free(Nob_Jobs *jobs)
+{
+    for (size_t i = 0; i < jobs->count; ++i) nob_cmd_free(jobs->items[i].cmd);
+    NOB_FREE(jobs->items);
+    jobs->items = NULL;
+    jobs->count = 0;
+    jobs->capacity = 0;
+}
+
 bool nob_cmd_run_sync(Nob_Cmd cmd)
 {
     Nob_Proc p = nob_cmd_run_async(cmd);
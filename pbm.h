@@ -0,0 +1,357 @@
+// Loader for .pbm bitmaps straight into a Grid, both plain (P1) and raw (P4), with comments and any
+// whitespace the format allows in the header. The file is memory mapped and the raster is packed
+// into the grid's 64-bit words as it's read, without going through a string per pixel, so masks of
+// millions of pixels load quickly. Large rasters are split over a WorkerPool: P4 rows sit at fixed
+// offsets and convert independently, P1 is counted in chunks first so every chunk knows where its
+// first pixel lands.
+//
+// Like nob.h, this is a single-header library: define PBM_IMPLEMENTATION in exactly one translation
+// unit before including it. Needs grid.h and workers.h.
+
+#ifndef PBM_H_
+#define PBM_H_
+
+#include <stdbool.h>
+
+#include "grid.h"
+#include "workers.h"
+
+#define PBM_CHUNK_BYTES (64 * 1024)  // P1 rasters are counted and packed in chunks of this size
+
+// Load the bitmap at `filePath` into a freshly allocated grid. Pbm pixels are 1 for black, and a
+// tile is set where the pixel is black, or where it's white if `setWhite` is true. `pool` may be
+// NULL. On failure returns false and points `error` at a static description.
+bool pbmLoad(const char *filePath, bool setWhite, WorkerPool *pool, Grid *grid, const char **error);
+
+#endif  // PBM_H_
+
+#ifdef PBM_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} PbmMapping;
+
+static bool pbmMap(const char *filePath, PbmMapping *mapping) {
+    *mapping = (PbmMapping){0};
+#ifdef _WIN32
+    mapping->file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mapping->file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mapping->file, &size) || size.QuadPart == 0) {
+        CloseHandle(mapping->file);
+        return false;
+    }
+    mapping->size = (size_t)size.QuadPart;
+
+    mapping->mapping = CreateFileMappingA(mapping->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping->mapping) {
+        CloseHandle(mapping->file);
+        return false;
+    }
+    mapping->data = MapViewOfFile(mapping->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mapping->data) {
+        CloseHandle(mapping->mapping);
+        CloseHandle(mapping->file);
+        return false;
+    }
+    return true;
+#else
+    int fd = open(filePath, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    mapping->size = (size_t)st.st_size;
+
+    void *data = mmap(NULL, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file around
+    if (data == MAP_FAILED) return false;
+    madvise(data, mapping->size, MADV_SEQUENTIAL);
+    mapping->data = data;
+    return true;
+#endif
+}
+
+static void pbmUnmap(PbmMapping *mapping) {
+#ifdef _WIN32
+    UnmapViewOfFile(mapping->data);
+    CloseHandle(mapping->mapping);
+    CloseHandle(mapping->file);
+#else
+    munmap((void *)mapping->data, mapping->size);
+#endif
+}
+
+static bool pbmIsSpace(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Skip whitespace and comments, which run from # to the end of the line.
+static size_t pbmSkipSpace(const unsigned char *data, size_t size, size_t i) {
+    while (i < size) {
+        if (data[i] == '#') {
+            while (i < size && data[i] != '\n') i++;
+        } else if (pbmIsSpace(data[i])) {
+            i++;
+        } else {
+            break;
+        }
+    }
+    return i;
+}
+
+// Parse a positive decimal header field starting at *i.
+static bool pbmParseSize(const unsigned char *data, size_t size, size_t *i, int *value) {
+    *i = pbmSkipSpace(data, size, *i);
+    long result = 0;
+    size_t start = *i;
+    while (*i < size && data[*i] >= '0' && data[*i] <= '9') {
+        result = result * 10 + (data[*i] - '0');
+        if (result > 1 << 24) return false;  // 16M pixels a side is plenty
+        (*i)++;
+    }
+    *value = (int)result;
+    return *i > start && result > 0;
+}
+
+typedef struct {
+    const unsigned char *raster;
+    size_t size;  // bytes of raster
+    Grid *grid;
+    uint64_t flip;  // all ones if white pixels become set tiles
+
+    // P1 only, per chunk of chunkBytes bytes
+    size_t chunkBytes;
+    size_t *firstPixel;  // counts of pixels per chunk, turned into the index of each chunk's first pixel
+    bool *hasComment;
+    bool *hasJunk;
+} PbmJob;
+
+// Reverses the bits of a byte: P4 stores the leftmost pixel in the most significant bit, a grid
+// in the least significant one.
+static unsigned char pbmReversed[256];
+
+static void pbmInitReversed(void) {
+    for (int b = 0; b < 256; b++) {
+        unsigned char r = 0;
+        for (int i = 0; i < 8; i++) r |= ((b >> i) & 1) << (7 - i);
+        pbmReversed[b] = r;
+    }
+}
+
+static void pbmRawRows(void *context, int y1, int y2) {
+    PbmJob *job = context;
+    Grid *grid = job->grid;
+    size_t rowBytes = ((size_t)grid->cols + 7) / 8;
+    int rowWords = gridRowWords(grid);
+    int tail = grid->cols % GRID_WORD_BITS;
+    uint64_t tailMask = tail == 0 ? ~(uint64_t)0 : ((uint64_t)1 << tail) - 1;
+
+    for (int y = y1; y < y2; y++) {
+        const unsigned char *bytes = job->raster + (size_t)y * rowBytes;
+        uint64_t *row = gridRow(grid, y);
+        for (int w = 0; w < rowWords; w++) {
+            uint64_t word = 0;
+            size_t first = (size_t)w * 8;
+            size_t last = first + 8 < rowBytes ? first + 8 : rowBytes;
+            for (size_t b = first; b < last; b++) word |= (uint64_t)pbmReversed[bytes[b]] << ((b - first) * 8);
+            word ^= job->flip;
+            row[w] = w == rowWords - 1 ? word & tailMask : word;
+        }
+    }
+}
+
+// Count the pixels of chunks [c1, c2). Comments are skipped, which is only right if none of them
+// crosses into the next chunk, so the caller has to fall back to a single chunk if there are any.
+static void pbmCountChunks(void *context, int c1, int c2) {
+    PbmJob *job = context;
+    for (int c = c1; c < c2; c++) {
+        size_t start = (size_t)c * job->chunkBytes;
+        size_t end = start + job->chunkBytes < job->size ? start + job->chunkBytes : job->size;
+        size_t pixels = 0;
+        for (size_t i = start; i < end; i++) {
+            unsigned char ch = job->raster[i];
+            if (ch == '0' || ch == '1') {
+                pixels++;
+            } else if (ch == '#') {
+                job->hasComment[c] = true;
+                while (i < end && job->raster[i] != '\n') i++;
+            } else if (!pbmIsSpace(ch)) {
+                job->hasJunk[c] = true;
+            }
+        }
+        job->firstPixel[c] = pixels;
+    }
+}
+
+// Pack the pixels of chunks [c1, c2). Words shared with a neighbouring chunk are merged in with an
+// atomic OR, that's at most two per chunk.
+static void pbmPlainChunks(void *context, int c1, int c2) {
+    PbmJob *job = context;
+    Grid *grid = job->grid;
+    size_t pixelCount = (size_t)grid->cols * grid->rows;
+
+    for (int c = c1; c < c2; c++) {
+        size_t pixel = job->firstPixel[c];
+        if (pixel >= pixelCount) return;
+
+        size_t start = (size_t)c * job->chunkBytes;
+        size_t end = start + job->chunkBytes < job->size ? start + job->chunkBytes : job->size;
+        int y = pixel / grid->cols;
+        int x = pixel % grid->cols;
+        uint64_t *word = &gridRow(grid, y)[x / GRID_WORD_BITS];
+        uint64_t bits = 0;
+        bool shared = true;  // the first word may have been started by the previous chunk
+        for (size_t i = start; i < end; i++) {
+            unsigned char ch = job->raster[i];
+            if (ch == '#') {
+                while (i < end && job->raster[i] != '\n') i++;
+                continue;
+            }
+            if (ch != '0' && ch != '1') continue;
+
+            bits |= (((uint64_t)(ch - '0') ^ job->flip) & 1) << (x % GRID_WORD_BITS);
+            x++;
+            if (x % GRID_WORD_BITS != 0 && x != grid->cols) continue;
+
+            if (shared) {
+                __atomic_fetch_or(word, bits, __ATOMIC_RELAXED);
+                shared = false;
+            } else {
+                *word = bits;
+            }
+            bits = 0;
+            if (x == grid->cols) {
+                x = 0;
+                y++;
+                if (y == grid->rows) break;  // anything past the last pixel is ignored
+            }
+            word = &gridRow(grid, y)[x / GRID_WORD_BITS];
+        }
+        // The next chunk finishes this word.
+        if (bits != 0) __atomic_fetch_or(word, bits, __ATOMIC_RELAXED);
+    }
+}
+
+bool pbmLoad(const char *filePath, bool setWhite, WorkerPool *pool, Grid *grid, const char **error) {
+    bool result = false;
+    PbmJob job = {.flip = setWhite ? ~(uint64_t)0 : 0, .chunkBytes = PBM_CHUNK_BYTES};
+    *grid = (Grid){0};
+
+    PbmMapping mapping;
+    if (!pbmMap(filePath, &mapping)) {
+        *error = "could not map the file";
+        return false;
+    }
+    const unsigned char *data = mapping.data;
+    size_t size = mapping.size;
+
+    if (size < 2 || data[0] != 'P' || (data[1] != '1' && data[1] != '4')) {
+        *error = "expected a .pbm with magic number P1 or P4";
+        goto defer;
+    }
+    bool raw = data[1] == '4';
+
+    size_t i = 2;
+    int cols, rows;
+    if (!pbmParseSize(data, size, &i, &cols) || !pbmParseSize(data, size, &i, &rows)) {
+        *error = "invalid dimensions";
+        goto defer;
+    }
+    // Exactly one whitespace character separates the header from the raster.
+    if (i == size || !pbmIsSpace(data[i])) {
+        *error = "missing raster";
+        goto defer;
+    }
+    i++;
+
+    *grid = gridAlloc(rows, cols);
+    if (!grid->words) {
+        *error = "out of memory";
+        goto defer;
+    }
+    job.raster = data + i;
+    job.size = size - i;
+    job.grid = grid;
+
+    if (raw) {
+        if (job.size < ((size_t)cols + 7) / 8 * rows) {
+            *error = "raster is truncated";
+            goto defer;
+        }
+        if (pbmReversed[1] == 0) pbmInitReversed();
+        workerPoolRun(pool, 0, rows, pbmRawRows, &job);
+        result = true;
+        goto defer;
+    }
+
+    int chunkCount = (job.size + job.chunkBytes - 1) / job.chunkBytes;
+    job.firstPixel = calloc(chunkCount, sizeof(size_t));
+    job.hasComment = calloc(chunkCount, sizeof(bool));
+    job.hasJunk = calloc(chunkCount, sizeof(bool));
+    if (!job.firstPixel || !job.hasComment || !job.hasJunk) {
+        *error = "out of memory";
+        goto defer;
+    }
+    workerPoolRun(pool, 0, chunkCount, pbmCountChunks, &job);
+
+    bool hasComment = false;
+    for (int c = 0; c < chunkCount; c++) hasComment = hasComment || job.hasComment[c];
+    if (hasComment && chunkCount > 1) {
+        // A comment may cross chunks, which throws the counts off, so go over it all in one chunk.
+        chunkCount = 1;
+        job.chunkBytes = job.size;
+        job.hasJunk[0] = false;
+        pbmCountChunks(&job, 0, 1);
+    }
+
+    size_t pixels = 0;
+    for (int c = 0; c < chunkCount; c++) {
+        if (job.hasJunk[c]) {
+            *error = "unexpected character in the raster, pixels have to be 0 or 1";
+            goto defer;
+        }
+        size_t count = job.firstPixel[c];
+        job.firstPixel[c] = pixels;
+        pixels += count;
+    }
+    if (pixels < (size_t)cols * rows) {
+        *error = "raster is truncated";
+        goto defer;
+    }
+
+    workerPoolRun(pool, 0, chunkCount, pbmPlainChunks, &job);
+    result = true;
+
+defer:
+    free(job.firstPixel);
+    free(job.hasComment);
+    free(job.hasJunk);
+    pbmUnmap(&mapping);
+    if (!result) gridFree(grid);
+    return result;
+}
+
+#endif  // PBM_IMPLEMENTATION
@@ -1,398 +1,1235 @@
-// TODO: Optimize drawing so larger canvases don't lag. Mostly including drawing in the functions
-// that manipulate the state, so it doesn't need to be iterated over twice.
-
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
 #define NOB_IMPLEMENTATION
 #include "nob.h"
+#define GRID_IMPLEMENTATION
+#include "grid.h"
+#define WORKERS_IMPLEMENTATION
+#include "workers.h"
+#define PBM_IMPLEMENTATION
+#include "pbm.h"
+#define SHAPES_IMPLEMENTATION
+#include "shapes.h"
 #include "raylib.h"
+#include "resources.h"  // generated by nob.c
 
-#define WINDOW_WIDTH 800
-#define WINDOW_HEIGHT 600
-#define TILE_SIZE 5
-#define ROWS WINDOW_HEIGHT / TILE_SIZE
-#define COLS WINDOW_WIDTH / TILE_SIZE
 #define CLOCK_STEP PI / 30  // 6 degrees in radians
+#define CLOCK_POSITIONS 60
+#define TICKS_PER_CYCLE 60
+#define MAX_CATCH_UP_TICKS 8  // past this many ticks in a single frame the backlog gets dropped
+#define MIN_THREADED_LINES 16  // smaller batches of lines are drawn on the calling thread
 
-typedef enum Screen {
-    MENU = 0,
-    LINES,
-    CLOCK,
-    DVD,
-} Screen;
-
+// Window size and tile size are picked on the command line, rows and cols are derived from them.
 typedef struct {
+    int windowWidth;
+    int windowHeight;
+    int tileSize;
     int rows;
     int cols;
+} Canvas;
+
+Canvas canvas = {
+    .windowWidth = 800,
+    .windowHeight = 600,
+    .tileSize = 5,
+};
+
+// Simulations advance in fixed ticks, independently of how fast frames get rendered.
+int tickRate = 60;
+
+// Full-canvas grid operations are split in bands of rows over these threads.
+WorkerPool *workers = NULL;
+
+// Number of random lines the lines screen draws at once.
+int lineCount = 1;
+
+// Number of DVD logos bouncing around at once, all sharing the same mask.
+int dvdCount = 1;
+
+// Birth and survival rule of the life screen, set with -life-rule.
+GridLifeRule lifeRule = GRID_LIFE_CONWAY;
+
+// Rasterized circles, so the ones drawn over and over are just XORed back in. Only circle() draws
+// through it, which none of the screens call: the clock keeps its ring and hands as spans and the
+// lines are random. Off (NULL) unless -shape-cache gives it memory, so it only helps scripted or
+// repeated shapes.
+ShapeCache *shapes = NULL;
+int shapeCacheKiB = 0;
+
+// Directory to load the resources from at runtime, NULL for the copies embedded by nob.c.
+const char *resourcesPath = NULL;
+
+// What's on screen: the menu, or a simulation by its index in `simulations`.
+typedef int Screen;
+enum { MENU = -1 };
+
+// The grid is kept on the GPU as a one-byte-per-tile grayscale texture, so drawing it is a single
+// scaled quad instead of one DrawRectangle (and a few batch flushes) per set tile.
+typedef struct {
+    unsigned char *pixels;
+    Texture2D texture;
+} GridRenderer;
+
+typedef struct {
+    int cols;
     int spacing;
     int titleBarHeight;
-    Vector2 selectedTile;
+    int selected;  // index of the highlighted simulation
 } MenuState;
 
 typedef struct {
-    Vector2 p1;
-    Vector2 p2;
+    int count;
+    GridSegment *segments;  // the batch drawn last
 } LinesState;
 
+// Everything the clock draws is worked out once for the canvas: the ring and every hand position as
+// spans, so a tick is just XORing cached geometry.
 typedef struct {
     int radius;
-    Vector2 handOrigin;
-    Vector2 handDest;
+    GridSpans ring;
+    GridRect ringRect;  // where the ring's spans go on the canvas
+    GridSpans hands[CLOCK_POSITIONS];
+    GridRect handRects[CLOCK_POSITIONS];
+    int hand;  // position the hand was drawn at last
 } ClockState;
 
+// The logos are stored as structure of arrays, so moving all of them is a single vectorizable loop.
 typedef struct {
-    int maskWidth;
-    int maskHeight;
-    bool *mask;
-    Vector2 direction;
-    Vector2 origin;
+    Grid mask;
+    GridSpans spans;  // the mask compiled once it's loaded, what actually gets XORed
+    int count;
+    int *x;  // top-left corner of every logo
+    int *y;
+    int *dx;  // direction of every logo, -1 or 1 on both axes
+    int *dy;
 } DvdState;
 
-int getSign(int n) {
-    if (n > 0)
-        return 1;
-    else if (n < 0)
-        return -1;
-    else
-        return 0;
-}
+// Life plays out on a grid of its own (see ownGrid in Simulation), the next generation is written
+// here and swapped in.
+typedef struct {
+    Grid next;
+    GridLifeRule rule;
+} LifeState;
 
 int euclideanModulo(int a, int b) {
     return (a % b + b) % b;
 }
 
-void initGrid(bool grid[ROWS][COLS]) {
-    for (size_t y = 0; y < ROWS; y++) {
-        for (size_t x = 0; x < COLS; x++) {
-            grid[y][x] = GetRandomValue(0, 1);
+void swapGridWords(Grid *a, Grid *b) {
+    uint64_t *words = a->words;
+    a->words = b->words;
+    b->words = words;
+}
+
+typedef struct {
+    Grid *grid;
+    uint64_t seed;
+} RandomizeJob;
+
+void randomizeBand(void *context, int y1, int y2) {
+    RandomizeJob *job = context;
+    gridRandomizeRows(job->grid, job->seed, y1, y2);
+}
+
+void initGrid(Grid *grid) {
+    // Seed the grid's own generator from raylib's, so SetRandomSeed() still controls the outcome.
+    RandomizeJob job = {.grid = grid};
+    for (int i = 0; i < 4; i++) job.seed = (job.seed << 16) | GetRandomValue(0, 0xFFFF);
+    workerPoolRun(workers, 0, grid->rows, randomizeBand, &job);
+}
+
+GridRenderer loadGridRenderer(void) {
+    GridRenderer renderer = {0};
+    renderer.pixels = malloc((size_t)canvas.rows * canvas.cols);
+    if (!renderer.pixels) {
+        nob_log(NOB_ERROR, "No RAM?");
+        exit(1);
+    }
+    memset(renderer.pixels, RAYWHITE.r, (size_t)canvas.rows * canvas.cols);
+
+    Image image = {
+        .data = renderer.pixels,
+        .width = canvas.cols,
+        .height = canvas.rows,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE,
+    };
+    renderer.texture = LoadTextureFromImage(image);
+    SetTextureFilter(renderer.texture, TEXTURE_FILTER_POINT);
+
+    return renderer;
+}
+
+void unloadGridRenderer(GridRenderer renderer) {
+    UnloadTexture(renderer.texture);
+    free(renderer.pixels);
+}
+
+// Only the tiles in `dirty` are converted and re-uploaded, everything else on the texture is still
+// up to date from the previous frames.
+typedef struct {
+    const Grid *grid;
+    GridRect rect;
+    unsigned char *pixels;
+} ToBytesJob;
+
+void toBytesBand(void *context, int y1, int y2) {
+    ToBytesJob *job = context;
+    GridRect band = {job->rect.x1, y1, job->rect.x2, y2};
+    size_t offset = (size_t)(y1 - job->rect.y1) * (job->rect.x2 - job->rect.x1);
+    gridRectToBytes(job->grid, band, job->pixels + offset, BLACK.r, RAYWHITE.r);
+}
+
+void drawGrid(const Grid *grid, GridRenderer renderer, GridRect dirty) {
+    dirty = gridRectClip(grid, dirty);
+    if (!gridRectIsEmpty(dirty)) {
+        ToBytesJob job = {.grid = grid, .rect = dirty, .pixels = renderer.pixels};
+        workerPoolRun(workers, dirty.y1, dirty.y2, toBytesBand, &job);
+        Rectangle rec = {dirty.x1, dirty.y1, dirty.x2 - dirty.x1, dirty.y2 - dirty.y1};
+        UpdateTextureRec(renderer.texture, rec, renderer.pixels);
+    }
+
+    Rectangle source = {0, 0, canvas.cols, canvas.rows};
+    Rectangle dest = {0, 0, canvas.cols * canvas.tileSize, canvas.rows * canvas.tileSize};
+    DrawTexturePro(renderer.texture, source, dest, (Vector2){0, 0}, 0.0f, WHITE);
+}
+
+typedef struct {
+    Grid *grid;
+    int x;
+    int y;
+    int radius;
+} CircleJob;
+
+void circleBand(void *context, int y1, int y2) {
+    CircleJob *job = context;
+    gridXorCircleRows(job->grid, job->x, job->y, job->radius, y1, y2);
+}
+
+// Cached if there's a cache, otherwise rasterized from scratch and split over the workers.
+GridRect circle(Grid *grid, Vector2 origin, int radius) {
+    if (radius < 0) return GRID_RECT_EMPTY;
+    if (shapes) return shapeXorCircle(shapes, grid, origin.x, origin.y, radius);
+
+    CircleJob job = {.grid = grid, .x = origin.x, .y = origin.y, .radius = radius};
+    workerPoolRun(workers, job.y - radius, job.y + radius + 1, circleBand, &job);
+    return gridRectClip(grid, (GridRect){job.x - radius, job.y - radius, job.x + radius + 1, job.y + radius + 1});
+}
+
+// The original full-grid scan, kept as the reference circle() has to match tile for tile.
+void circleBruteForce(Grid *grid, Vector2 origin, int radius) {
+    for (int y = 0; y < grid->rows; y++) {
+        for (int x = 0; x < grid->cols; x++) {
+            if (round(sqrt((x - origin.x) * (x - origin.x) + (y - origin.y) * (y - origin.y))) == radius) {
+                gridToggle(grid, x, y);
+            }
         }
     }
 }
 
-void drawGrid(bool grid[ROWS][COLS]) {
-    for (size_t y = 0; y < ROWS; y++) {
-        for (size_t x = 0; x < COLS; x++) {
-            if (grid[y][x])
-                DrawRectangle(x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE, BLACK);
+// Compare circle() against circleBruteForce() for every radius that fits the canvas, around the
+// center of the canvas and around points close to its corners so clipping gets exercised too.
+bool checkCircle(void) {
+    Grid expected = gridAlloc(canvas.rows, canvas.cols);
+    Grid actual = gridAlloc(canvas.rows, canvas.cols);
+    if (!expected.words || !actual.words) {
+        nob_log(NOB_ERROR, "No RAM?");
+        exit(1);
+    }
+
+    Vector2 origins[] = {{canvas.cols / 2, canvas.rows / 2}, {0, 0}, {canvas.cols - 1, 3}, {7, canvas.rows - 2}};
+    int maxRadius = (canvas.rows > canvas.cols ? canvas.rows : canvas.cols) + 2;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(origins); i++) {
+        for (int radius = 0; radius <= maxRadius; radius++) {
+            gridClear(&expected);
+            gridClear(&actual);
+            circleBruteForce(&expected, origins[i], radius);
+            circle(&actual, origins[i], radius);
+            if (memcmp(expected.words, actual.words, (size_t)canvas.rows * expected.stride * sizeof(uint64_t)) != 0) {
+                nob_log(NOB_ERROR, "circle() mismatch for origin (%d, %d) and radius %d.", (int)origins[i].x, (int)origins[i].y, radius);
+                mismatches++;
+            }
         }
     }
+
+    if (mismatches == 0) nob_log(NOB_INFO, "circle() matches the brute-force version for radii 0..%d.", maxRadius);
+
+    gridFree(&expected);
+    gridFree(&actual);
+    return mismatches == 0;
 }
 
-const char *tileNames[] = {"lines", "clock", "dvd", "placeholder", "placeholder", "placeholder"};
-const Screen screens[] = {LINES, CLOCK, DVD, MENU, MENU, MENU};
-void drawMenuTiles(MenuState menuState) {
-    float outlineWidth = (WINDOW_WIDTH - (menuState.cols + 1) * menuState.spacing) / menuState.cols;
-    float outlineHeight = (WINDOW_HEIGHT - menuState.titleBarHeight - (menuState.rows + 1) * menuState.spacing) / menuState.rows;
-    for (int i = 0; i < menuState.rows; i++) {
-        for (int j = 0; j < menuState.cols; j++) {
-            short tileIdx = i * menuState.cols + j;
-
-            float x = menuState.spacing * (j + 1) + outlineWidth * j;
-            float y = menuState.titleBarHeight + menuState.spacing * (i + 1) + outlineHeight * i;
-            float width = outlineWidth;
-            float height = outlineHeight;
-
-            Rectangle tile = {
-                .x = x,
-                .y = y,
-                .width = width,
-                .height = height,
-            };
-            Color tileColor = (i == menuState.selectedTile.y && j == menuState.selectedTile.x) ? MAROON : BLACK;
-            DrawRectangleLinesEx(tile, 5.0f, tileColor);
-
-            const char *tileName = tileNames[tileIdx];
-            DrawText(tileName,
-                     x + width / 2 - MeasureText(tileName, 20) / 2, y + height / 2 - 10,
-                     20, BLACK);
+bool checkMaskFits(int maskWidth, int maskHeight) {
+    if (maskWidth >= canvas.cols) {
+        nob_log(NOB_ERROR, "Mask too wide, should be less than %d, got %d.", canvas.cols, maskWidth);
+        return false;
+    }
+    if (maskHeight >= canvas.rows) {
+        nob_log(NOB_ERROR, "Mask too tall, should be less than %d, got %d.", canvas.rows, maskHeight);
+        return false;
+    }
+    return true;
+}
+
+// Load the mask from a plain (P1) or raw (P4) .pbm. The white pixels are the ones that get XORed.
+void parseMaskFromPbm(const char *filePath, DvdState *dvdState) {
+    const char *error;
+    if (!pbmLoad(filePath, true, workers, &dvdState->mask, &error)) {
+        nob_log(NOB_ERROR, "Could not load %s: %s.", filePath, error);
+        exit(1);
+    }
+    if (!checkMaskFits(dvdState->mask.cols, dvdState->mask.rows)) exit(1);
+}
+
+typedef struct {
+    Grid *grid;
+    const DvdState *dvdState;
+} DvdJob;
+
+// XOR the rows in [y1, y2) of every logo crossing them.
+void dvdBand(void *context, int y1, int y2) {
+    DvdJob *job = context;
+    const DvdState *dvdState = job->dvdState;
+    int rows = dvdState->spans.rows;
+    for (int i = 0; i < dvdState->count; i++) {
+        if (dvdState->y[i] >= y2 || dvdState->y[i] + rows <= y1) continue;
+        gridXorSpansRows(job->grid, &dvdState->spans, dvdState->x[i], dvdState->y[i], y1, y2);
+    }
+}
+
+// Blit every logo, given that their top-left corners all lie within [x1, x2] x [y1, y2]. Returns the
+// rectangle that changed.
+GridRect dvd(Grid *grid, const DvdState *dvdState, int x1, int y1, int x2, int y2) {
+    DvdJob job = {.grid = grid, .dvdState = dvdState};
+    workerPoolRun(workers, y1, y2 + dvdState->spans.rows, dvdBand, &job);
+    GridRect bounds = dvdState->spans.bounds;
+    if (gridRectIsEmpty(bounds)) return GRID_RECT_EMPTY;
+    return (GridRect){x1 + bounds.x1, y1 + bounds.y1, x2 + bounds.x2, y2 + bounds.y2};
+}
+
+// The mask nob.c packed from ./resources/dvd.pbm at build time.
+void loadEmbeddedMask(DvdState *dvdState) {
+    if (!checkMaskFits(EMBEDDED_DVD_MASK_COLS, EMBEDDED_DVD_MASK_ROWS)) exit(1);
+
+    dvdState->mask = gridAlloc(EMBEDDED_DVD_MASK_ROWS, EMBEDDED_DVD_MASK_COLS);
+    if (!dvdState->mask.words) {
+        nob_log(NOB_ERROR, "No RAM?");
+        exit(1);
+    }
+    for (int y = 0; y < EMBEDDED_DVD_MASK_ROWS; y++) {
+        memcpy(gridRow(&dvdState->mask, y), &embeddedDvdMask[y * EMBEDDED_DVD_MASK_ROW_WORDS], EMBEDDED_DVD_MASK_ROW_WORDS * sizeof(uint64_t));
+    }
+}
+
+
+void setWindowIcon(void) {
+    if (resourcesPath) {
+        Image icon = LoadImage(nob_temp_sprintf("%s/pov-you-wake-up-in-poland.png", resourcesPath));
+        SetWindowIcon(icon);
+        UnloadImage(icon);
+        return;
+    }
+
+    Image icon = {
+        .data = (void *)embeddedIconPixels,  // SetWindowIcon() only reads it
+        .width = EMBEDDED_ICON_WIDTH,
+        .height = EMBEDDED_ICON_HEIGHT,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    };
+    SetWindowIcon(icon);
+}
+
+typedef struct {
+    Grid *grid;
+    const LinesState *linesState;
+} LinesJob;
+
+void linesBand(void *context, int y1, int y2) {
+    LinesJob *job = context;
+    gridXorLinesRows(job->grid, job->linesState->segments, job->linesState->count, y1, y2);
+}
+
+void *initLines(Grid *grid) {
+    (void)grid;
+    LinesState *linesState = calloc(1, sizeof(LinesState));
+    if (!linesState) return NULL;
+
+    linesState->count = lineCount;
+    linesState->segments = calloc(lineCount, sizeof(GridSegment));
+    if (!linesState->segments) {
+        free(linesState);
+        return NULL;
+    }
+    return linesState;
+}
+
+GridRect stepLines(void *state, Grid *grid, unsigned int tickCount) {
+    (void)tickCount;
+    LinesState *linesState = state;
+
+    // The endpoints may land one past the last row and column, the lines get clipped anyway.
+    GridRect dirty = GRID_RECT_EMPTY;
+    for (int i = 0; i < linesState->count; i++) {
+        GridSegment *l = &linesState->segments[i];
+        l->x1 = GetRandomValue(0, canvas.cols);
+        l->y1 = GetRandomValue(0, canvas.rows);
+        l->x2 = GetRandomValue(0, canvas.cols);
+        l->y2 = GetRandomValue(0, canvas.rows);
+        dirty = gridRectUnion(dirty, gridSegmentBounds(*l));
+    }
+    dirty = gridRectClip(grid, dirty);
+
+    // Every band clips the whole batch to its rows, which only pays off once there are a few lines.
+    LinesJob job = {.grid = grid, .linesState = linesState};
+    if (linesState->count < MIN_THREADED_LINES) {
+        linesBand(&job, 0, grid->rows);
+    } else {
+        workerPoolRun(workers, dirty.y1, dirty.y2, linesBand, &job);
+    }
+    return dirty;
+}
+
+void teardownLines(void *state) {
+    LinesState *linesState = state;
+    free(linesState->segments);
+    free(linesState);
+}
+
+// Rasterize the ring and the hand at each position once, clipped to the canvas. The positions come
+// from a table so the hand can't drift the way rotating it step by step did.
+void *initClock(Grid *grid) {
+    ClockState *clockState = calloc(1, sizeof(ClockState));
+    if (!clockState) return NULL;
+
+    int x = grid->cols / 2;
+    int y = grid->rows / 2;
+    int radius = grid->rows / 2 * 3 / 4;
+    clockState->radius = radius;
+
+    GridRect rect = gridRectClip(grid, (GridRect){x - radius, y - radius, x + radius + 1, y + radius + 1});
+    clockState->ringRect = rect;
+    Grid ring = gridAlloc(rect.y2 - rect.y1, rect.x2 - rect.x1);
+    bool compiled = false;
+    if (ring.words) {
+        gridXorCircle(&ring, x - rect.x1, y - rect.y1, radius);
+        compiled = gridCompileSpans(&ring, &clockState->ring);
+    }
+    gridFree(&ring);
+
+    for (int i = 0; compiled && i < CLOCK_POSITIONS; i++) {
+        GridSegment hand = {
+            x, y, x + round(radius * sin(i * CLOCK_STEP)), y - round(radius * cos(i * CLOCK_STEP)),
+        };
+        rect = gridRectClip(grid, gridSegmentBounds(hand));
+        clockState->handRects[i] = rect;
+        Grid scratch = gridAlloc(rect.y2 - rect.y1, rect.x2 - rect.x1);
+        compiled = false;
+        if (scratch.words) {
+            gridXorLine(&scratch, hand.x1 - rect.x1, hand.y1 - rect.y1, hand.x2 - rect.x1, hand.y2 - rect.y1);
+            compiled = gridCompileSpans(&scratch, &clockState->hands[i]);
         }
+        gridFree(&scratch);
     }
+    if (!compiled) {
+        gridFreeSpans(&clockState->ring);
+        for (int i = 0; i < CLOCK_POSITIONS; i++) gridFreeSpans(&clockState->hands[i]);
+        free(clockState);
+        return NULL;
+    }
+    return clockState;
+}
+
+// Stepped every 3 ticks to flicker the ring, the hand moves once per cycle.
+GridRect stepClock(void *state, Grid *grid, unsigned int tickCount) {
+    ClockState *clockState = state;
+    GridRect dirty = gridXorSpans(grid, &clockState->ring, clockState->ringRect.x1, clockState->ringRect.y1);
+
+    if (tickCount == 0) {
+        clockState->hand = (clockState->hand + 1) % CLOCK_POSITIONS;
+        GridRect rect = clockState->handRects[clockState->hand];
+        dirty = gridRectUnion(dirty, gridXorSpans(grid, &clockState->hands[clockState->hand], rect.x1, rect.y1));
+    }
+
+    return dirty;
+}
+
+void teardownClock(void *state) {
+    ClockState *clockState = state;
+    gridFreeSpans(&clockState->ring);
+    for (int i = 0; i < CLOCK_POSITIONS; i++) gridFreeSpans(&clockState->hands[i]);
+    free(clockState);
 }
 
-// Flip the pixels between (x1, y1) and (x2, y2) using Bresenham's algorithm generalized to work
-// with any slope. Credit: https://www.uobabylon.edu.iq/eprints/publication_2_22893_6215.pdf.
-void line(bool grid[ROWS][COLS], int x1, int y1, int x2, int y2) {
-    int dx, dy, x, y, e, a, b, s1, s2, swapped = 0, temp;
+void teardownDvd(void *state) {
+    DvdState *dvdState = state;
+    free(dvdState->x);
+    free(dvdState->y);
+    free(dvdState->dx);
+    free(dvdState->dy);
+    gridFreeSpans(&dvdState->spans);
+    gridFree(&dvdState->mask);
+    free(dvdState);
+}
 
-    dx = abs(x2 - x1);
-    dy = abs(y2 - y1);
+// Scatter the logos over the canvas. The first one starts off down and to the right like the single
+// logo always did, the others in random directions.
+void *initDvd(Grid *grid) {
+    (void)grid;
+    DvdState *dvdState = calloc(1, sizeof(DvdState));
+    if (!dvdState) return NULL;
+
+    if (resourcesPath) {
+        parseMaskFromPbm(nob_temp_sprintf("%s/dvd.pbm", resourcesPath), dvdState);
+    } else {
+        loadEmbeddedMask(dvdState);
+    }
 
-    s1 = getSign(x2 - x1);
-    s2 = getSign(y2 - y1);
+    int count = dvdCount;
+    dvdState->count = count;
+    dvdState->x = malloc(count * sizeof(int));
+    dvdState->y = malloc(count * sizeof(int));
+    dvdState->dx = malloc(count * sizeof(int));
+    dvdState->dy = malloc(count * sizeof(int));
+    if (!gridCompileSpans(&dvdState->mask, &dvdState->spans) || !dvdState->x || !dvdState->y || !dvdState->dx || !dvdState->dy) {
+        teardownDvd(dvdState);
+        return NULL;
+    }
 
-    if (dy > dx) {
-        temp = dx;
-        dx = dy;
-        dy = temp;
-        swapped = 1;
+    for (int i = 0; i < count; i++) {
+        dvdState->x[i] = GetRandomValue(0, canvas.cols - dvdState->mask.cols);
+        dvdState->y[i] = GetRandomValue(0, canvas.rows - dvdState->mask.rows);
+        dvdState->dx[i] = i == 0 ? 1 : GetRandomValue(0, 1) * 2 - 1;
+        dvdState->dy[i] = i == 0 ? 1 : GetRandomValue(0, 1) * 2 - 1;
     }
+    return dvdState;
+}
 
-    e = 2 * dy - dx;
-    a = 2 * dy;
-    b = 2 * dy - 2 * dx;
+GridRect stepDvd(void *state, Grid *grid, unsigned int tickCount) {
+    (void)tickCount;
+    DvdState *dvdState = state;
+
+    // Bounce off the edges and move, all the logos in one pass. Selects instead of branches, so the
+    // compiler can turn the loop into vector compares and blends, and the bounding box of the logos
+    // falls out of the same pass.
+    int *restrict x = dvdState->x;
+    int *restrict y = dvdState->y;
+    int *restrict dx = dvdState->dx;
+    int *restrict dy = dvdState->dy;
+    int count = dvdState->count;
+    int maxX = canvas.cols - dvdState->mask.cols;
+    int maxY = canvas.rows - dvdState->mask.rows;
+    int x1 = INT_MAX, y1 = INT_MAX, x2 = INT_MIN, y2 = INT_MIN;
+    for (int i = 0; i < count; i++) {
+        dx[i] = x[i] == maxX ? -1 : x[i] == 0 ? 1 : dx[i];
+        dy[i] = y[i] == maxY ? -1 : y[i] == 0 ? 1 : dy[i];
+        x[i] += dx[i];
+        y[i] += dy[i];
+
+        x1 = x[i] < x1 ? x[i] : x1;
+        y1 = y[i] < y1 ? y[i] : y1;
+        x2 = x[i] > x2 ? x[i] : x2;
+        y2 = y[i] > y2 ? y[i] : y2;
+    }
 
-    x = x1;
-    y = y1;
-    for (int i = 1; i < dx; i++) {
-        grid[y][x] = !grid[y][x];
+    return dvd(grid, dvdState, x1, y1, x2, y2);
+}
 
-        if (e < 0) {
-            if (swapped)
-                y = y + s2;
-            else
-                x = x + s1;
-            e = e + a;
-        } else {
-            y = y + s2;
-            x = x + s1;
-            e = e + b;
+typedef struct {
+    const Grid *grid;
+    LifeState *lifeState;
+} LifeJob;
+
+void lifeBand(void *context, int y1, int y2) {
+    LifeJob *job = context;
+    gridLifeRows(job->grid, &job->lifeState->next, job->lifeState->rule, y1, y2);
+}
+
+void *initLife(Grid *grid) {
+    LifeState *lifeState = calloc(1, sizeof(LifeState));
+    if (!lifeState) return NULL;
+
+    lifeState->rule = lifeRule;
+    lifeState->next = gridAlloc(grid->rows, grid->cols);
+    if (!lifeState->next.words) {
+        free(lifeState);
+        return NULL;
+    }
+    return lifeState;
+}
+
+// One generation every tick. Every tile may change, so the whole grid is dirty.
+GridRect stepLife(void *state, Grid *grid, unsigned int tickCount) {
+    (void)tickCount;
+    LifeState *lifeState = state;
+    LifeJob job = {.grid = grid, .lifeState = lifeState};
+    workerPoolRun(workers, 0, grid->rows, lifeBand, &job);
+
+    swapGridWords(grid, &lifeState->next);
+    return gridBounds(grid);
+}
+
+void teardownLife(void *state) {
+    LifeState *lifeState = state;
+    gridFree(&lifeState->next);
+    free(lifeState);
+}
+
+// Parse a rule in B/S notation, e.g. B3/S23 for Conway's Life or B36/S23 for HighLife.
+bool parseLifeRule(const char *text, GridLifeRule *rule) {
+    *rule = (GridLifeRule){0};
+    if (*text != 'B' && *text != 'b') return false;
+    for (text++; *text >= '0' && *text <= '8'; text++) rule->birth |= 1 << (*text - '0');
+    if (*text++ != '/') return false;
+    if (*text != 'S' && *text != 's') return false;
+    for (text++; *text >= '0' && *text <= '8'; text++) rule->survive |= 1 << (*text - '0');
+    return *text == '\0';
+}
+
+// A simulation the menu can show. init() sets the simulation up on a freshly initialized grid and
+// returns its state, NULL if it couldn't. step() is called every `ticksPerStep` ticks with the tick
+// count (which wraps at TICKS_PER_CYCLE) and returns the rectangle of tiles it changed.
+//
+// The others XOR their drawings over the same noise, but a simulation with `ownGrid` would wipe
+// that out, so it gets a grid of its own instead, seeded with initGrid() every time it's shown.
+typedef struct {
+    const char *name;
+    int ticksPerStep;
+    bool ownGrid;
+    void *(*init)(Grid *grid);
+    GridRect (*step)(void *state, Grid *grid, unsigned int tickCount);
+    void (*teardown)(void *state);
+} Simulation;
+
+// In menu order. The simulations are set up in this order too, which decides what they get out of
+// the random seed.
+const Simulation simulations[] = {
+    {"lines", 15, false, initLines, stepLines, teardownLines},
+    {"clock", 3, false, initClock, stepClock, teardownClock},
+    {"dvd", 2, false, initDvd, stepDvd, teardownDvd},
+    {"life", 1, true, initLife, stepLife, teardownLife},
+};
+#define SIMULATION_COUNT ((int)NOB_ARRAY_LEN(simulations))
+
+// Time spent in a simulation's step(), kept by stepWorld() for all of them.
+typedef struct {
+    size_t steps;
+    double seconds;
+    double maxSeconds;
+} SimulationStats;
+
+// Everything the simulations mutate: the grid on screen and the state of each simulation.
+typedef struct {
+    Grid grid;  // the shared one, unless a simulation with its own grid is shown
+    Grid ownGrids[SIMULATION_COUNT];  // swapped with `grid` while their simulation is shown
+    Screen shown;
+    void *states[SIMULATION_COUNT];
+    SimulationStats stats[SIMULATION_COUNT];
+} World;
+
+World loadWorld(void) {
+    World world = {.shown = MENU};
+
+    world.grid = gridAlloc(canvas.rows, canvas.cols);
+    if (!world.grid.words) {
+        nob_log(NOB_ERROR, "No RAM?");
+        exit(1);
+    }
+    initGrid(&world.grid);
+
+    for (int i = 0; i < SIMULATION_COUNT; i++) {
+        if (!simulations[i].ownGrid) continue;
+        world.ownGrids[i] = gridAlloc(canvas.rows, canvas.cols);
+        if (!world.ownGrids[i].words) {
+            nob_log(NOB_ERROR, "No RAM?");
+            exit(1);
+        }
+    }
+
+    for (int i = 0; i < SIMULATION_COUNT; i++) {
+        world.states[i] = simulations[i].init(&world.grid);
+        if (!world.states[i]) {
+            nob_log(NOB_ERROR, "Could not set up %s. No RAM?", simulations[i].name);
+            exit(1);
         }
     }
+
+    return world;
 }
 
-void lineV(bool grid[ROWS][COLS], Vector2 p1, Vector2 p2) {
-    line(grid, p1.x, p1.y, p2.x, p2.y);
+void unloadWorld(World *world) {
+    for (int i = 0; i < SIMULATION_COUNT; i++) {
+        simulations[i].teardown(world->states[i]);
+        gridFree(&world->ownGrids[i]);
+    }
+    gridFree(&world->grid);
 }
 
-void rectangle(bool grid[ROWS][COLS], Vector2 p1, Vector2 p2, Vector2 p3, Vector2 p4) {
-    lineV(grid, p1, p2);
-    lineV(grid, p2, p3);
-    lineV(grid, p3, p4);
-    lineV(grid, p4, p1);
+// Put the grid of `screen` in world->grid, swapping the shared one back in when leaving a simulation
+// with a grid of its own. Returns the rectangle of tiles that changed, all of them on a swap.
+GridRect showScreen(World *world, Screen screen) {
+    if (screen == world->shown) return GRID_RECT_EMPTY;
+
+    GridRect dirty = GRID_RECT_EMPTY;
+    if (world->shown != MENU && simulations[world->shown].ownGrid) {
+        swapGridWords(&world->grid, &world->ownGrids[world->shown]);
+        dirty = gridBounds(&world->grid);
+    }
+    if (screen != MENU && simulations[screen].ownGrid) {
+        swapGridWords(&world->grid, &world->ownGrids[screen]);
+        initGrid(&world->grid);
+        dirty = gridBounds(&world->grid);
+    }
+    world->shown = screen;
+    return dirty;
 }
 
-void circle(bool grid[ROWS][COLS], Vector2 origin, int radius) {
-    for (size_t y = 0; y < ROWS; y++) {
-        for (size_t x = 0; x < COLS; x++) {
-            if (round(sqrt((x - origin.x) * (x - origin.x) + (y - origin.y) * (y - origin.y))) == radius) {
-                grid[y][x] = !grid[y][x];
+// Advance the simulation shown on `screen` by one tick, stepping it if the tick is one of its own.
+// Returns the rectangle of tiles that changed.
+GridRect stepWorld(World *world, Screen screen, unsigned int tickCount) {
+    if (screen < 0 || screen >= SIMULATION_COUNT) return GRID_RECT_EMPTY;
+
+    const Simulation *simulation = &simulations[screen];
+    if (tickCount % simulation->ticksPerStep != 0) return GRID_RECT_EMPTY;
+
+    double start = nob_now_seconds();
+    GridRect dirty = simulation->step(world->states[screen], &world->grid, tickCount);
+    double elapsed = nob_now_seconds() - start;
+
+    SimulationStats *stats = &world->stats[screen];
+    stats->steps++;
+    stats->seconds += elapsed;
+    if (elapsed > stats->maxSeconds) stats->maxSeconds = elapsed;
+    return dirty;
+}
+
+void logSimulationStats(const World *world) {
+    for (int i = 0; i < SIMULATION_COUNT; i++) {
+        const SimulationStats *stats = &world->stats[i];
+        if (stats->steps == 0) continue;
+        nob_log(NOB_INFO, "%s: %zu steps, %.1fus on average, %.1fus at most", simulations[i].name,
+                stats->steps, stats->seconds / stats->steps * 1e6, stats->maxSeconds * 1e6);
+    }
+}
+
+void sleepSeconds(double seconds) {
+    if (seconds <= 0) return;
+    struct timespec ts = {.tv_sec = (time_t)seconds, .tv_nsec = (long)((seconds - (time_t)seconds) * 1e9)};
+    nanosleep(&ts, NULL);
+}
+
+// Runs the simulations on a thread of their own, so ticking overlaps with uploading and presenting
+// the previous state instead of adding up with it.
+//
+// The simulation thread works on world->grid and, after the ticks of each round, copies it into the
+// back buffer and swaps that with the latest published one. The render thread swaps the latest one
+// with its front buffer whenever there's a new one, so both threads only ever touch their own buffer.
+// Only the rectangles that changed get copied around: stale[i] tracks what buffer i is missing, and
+// a published buffer carries the dirty rectangle of everything the render thread hasn't seen yet.
+typedef struct {
+    World *world;
+    Grid buffers[3];
+    GridRect stale[3];     // owned by the simulation thread
+    GridRect carried[3];   // guarded by mutex while published, then owned by whoever holds the buffer
+    int back;              // owned by the simulation thread
+    int front;             // owned by the render thread
+    int latest;            // guarded by mutex
+    bool latestIsNew;      // guarded by mutex
+    pthread_mutex_t mutex;
+    pthread_t thread;
+
+    atomic_int screen;
+    atomic_bool paused;
+    atomic_bool quit;
+} Pipeline;
+
+void copyGridRect(Grid *dst, const Grid *src, GridRect rect) {
+    if (gridRectIsEmpty(rect)) return;
+
+    size_t w1 = rect.x1 / GRID_WORD_BITS;
+    size_t w2 = (rect.x2 - 1) / GRID_WORD_BITS + 1;
+    for (int y = rect.y1; y < rect.y2; y++) {
+        memcpy(gridRow(dst, y) + w1, gridRow(src, y) + w1, (w2 - w1) * sizeof(uint64_t));
+    }
+}
+
+void publishPipeline(Pipeline *pipeline, GridRect changed) {
+    int back = pipeline->back;
+    copyGridRect(&pipeline->buffers[back], &pipeline->world->grid, pipeline->stale[back]);
+    pipeline->stale[back] = GRID_RECT_EMPTY;
+
+    pthread_mutex_lock(&pipeline->mutex);
+    // If the render thread never picked up the previous buffer, its changes are still news.
+    GridRect carried = changed;
+    if (pipeline->latestIsNew) carried = gridRectUnion(carried, pipeline->carried[pipeline->latest]);
+    pipeline->carried[back] = carried;
+    pipeline->back = pipeline->latest;
+    pipeline->latest = back;
+    pipeline->latestIsNew = true;
+    pthread_mutex_unlock(&pipeline->mutex);
+}
+
+void *runPipeline(void *arg) {
+    Pipeline *pipeline = arg;
+    unsigned int tickCount = 0;
+    double tickDuration = 1.0 / tickRate;
+    double tickBacklog = 0.0;
+    double lastTime = nob_now_seconds();
+    while (!atomic_load(&pipeline->quit)) {
+        double now = nob_now_seconds();
+        tickBacklog += now - lastTime;
+        lastTime = now;
+
+        Screen screen = atomic_load(&pipeline->screen);
+        bool paused = atomic_load(&pipeline->paused);
+
+        // Same catch-up rules as the single-threaded loop in main().
+        GridRect changed = showScreen(pipeline->world, screen);
+        int ticks = 0;
+        while (tickBacklog >= tickDuration && ticks < MAX_CATCH_UP_TICKS) {
+            tickCount = (tickCount + 1) % TICKS_PER_CYCLE;
+            if (!paused) changed = gridRectUnion(changed, stepWorld(pipeline->world, screen, tickCount));
+            tickBacklog -= tickDuration;
+            ticks++;
+        }
+        if (tickBacklog >= tickDuration) tickBacklog = 0.0;
+
+        if (!gridRectIsEmpty(changed)) {
+            for (size_t i = 0; i < NOB_ARRAY_LEN(pipeline->stale); i++) {
+                pipeline->stale[i] = gridRectUnion(pipeline->stale[i], changed);
             }
+            publishPipeline(pipeline, changed);
         }
+
+        sleepSeconds(tickDuration - tickBacklog);
     }
+
+    return NULL;
 }
 
-void parseMaskFromPbm(const char *filePath, DvdState *dvdState) {
-    Nob_String_Builder sbContent = {0};
-    if (!nob_read_entire_file(filePath, &sbContent)) exit(1);
-    Nob_String_View svContent = nob_sv_from_parts(sbContent.items, sbContent.count);
-
-    size_t linesCount = 0;
-    bool *mask;
-    for (; svContent.count > 0; ++linesCount) {
-        Nob_String_View line = nob_sv_chop_by_delim(&svContent, '\n');
-        if (linesCount == 0) {
-            if (!nob_sv_eq(line, nob_sv_from_cstr("P1"))) {
-                nob_log(NOB_ERROR, "Invalid file format. Expected .pbm with magic number P1, got " SV_Fmt ".", SV_Arg(line));
-                exit(1);
-            }
+bool startPipeline(Pipeline *pipeline, World *world) {
+    *pipeline = (Pipeline){.world = world, .back = 0, .latest = 1, .front = 2};
+    for (size_t i = 0; i < NOB_ARRAY_LEN(pipeline->buffers); i++) {
+        pipeline->buffers[i] = gridAlloc(world->grid.rows, world->grid.cols);
+        if (!pipeline->buffers[i].words) {
+            nob_log(NOB_ERROR, "No RAM?");
+            exit(1);
         }
+        copyGridRect(&pipeline->buffers[i], &world->grid, gridBounds(&world->grid));
+    }
+    atomic_init(&pipeline->screen, MENU);
+    atomic_init(&pipeline->paused, false);
+    atomic_init(&pipeline->quit, false);
+    pthread_mutex_init(&pipeline->mutex, NULL);
+
+    if (pthread_create(&pipeline->thread, NULL, runPipeline, pipeline) != 0) {
+        nob_log(NOB_ERROR, "Could not start the simulation thread.");
+        pthread_mutex_destroy(&pipeline->mutex);
+        for (size_t i = 0; i < NOB_ARRAY_LEN(pipeline->buffers); i++) gridFree(&pipeline->buffers[i]);
+        return false;
+    }
+    return true;
+}
 
-        if (linesCount == 1) {
-            dvdState->maskWidth = strtol(nob_sv_chop_by_delim(&line, ' ').data, NULL, 10);
-            dvdState->maskHeight = strtol(line.data, NULL, 10);
-            if (dvdState->maskWidth == 0 || dvdState->maskHeight == 0) {
-                nob_log(NOB_ERROR, "Unexpected dimension in the %s file: %dx%d", filePath, dvdState->maskWidth, dvdState->maskHeight);
-                exit(1);
-            }
-            if (dvdState->maskWidth >= COLS) {
-                nob_log(NOB_ERROR, "Mask too wide, should be less than %d, got %d.", COLS, dvdState->maskWidth);
-                exit(1);
-            }
-            if (dvdState->maskHeight >= ROWS) {
-                nob_log(NOB_ERROR, "Mask too tall, should be less than %d, got %d.", ROWS, dvdState->maskHeight);
-                exit(1);
-            }
+void stopPipeline(Pipeline *pipeline) {
+    atomic_store(&pipeline->quit, true);
+    pthread_join(pipeline->thread, NULL);
+    pthread_mutex_destroy(&pipeline->mutex);
+    for (size_t i = 0; i < NOB_ARRAY_LEN(pipeline->buffers); i++) gridFree(&pipeline->buffers[i]);
+}
 
-            mask = malloc(dvdState->maskWidth * dvdState->maskHeight * sizeof(bool));
-            if (!mask) {
-                nob_log(NOB_ERROR, "No RAM?");
-                exit(1);
-            }
-        } else {
-            for (int i = 0; i < dvdState->maskWidth; i++) {
-                int color;  // 0 for white, 1 for black in the .pbm format
-                if (i == dvdState->maskWidth - 1) {
-                    color = strtol(nob_temp_sv_to_cstr(line), NULL, 10);
-                } else {
-                    color = strtol(nob_temp_sv_to_cstr(nob_sv_chop_by_delim(&line, ' ')), NULL, 10);
-                }
-
-                if (color < 0 || color > 1) {
-                    nob_log(NOB_ERROR, "Unexpected color in the %s file, expected 0 or 1, got: %d.", filePath, color);
-                    exit(1);
-                }
-
-                mask[(linesCount - 2) * dvdState->maskWidth + i] = !color;
-            }
+// Take the newest published grid, if there is one, adding whatever changed in it to `dirty`.
+const Grid *acquirePipelineGrid(Pipeline *pipeline, GridRect *dirty) {
+    pthread_mutex_lock(&pipeline->mutex);
+    if (pipeline->latestIsNew) {
+        int front = pipeline->latest;
+        pipeline->latest = pipeline->front;
+        pipeline->front = front;
+        pipeline->latestIsNew = false;
+        *dirty = gridRectUnion(*dirty, pipeline->carried[front]);
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    return &pipeline->buffers[pipeline->front];
+}
+
+// Write the grid as a binary (P4) .pbm, set tiles being black.
+bool dumpGridToPbm(const Grid *grid, const char *filePath) {
+    FILE *file = fopen(filePath, "wb");
+    if (!file) {
+        nob_log(NOB_ERROR, "Could not open %s: %s", filePath, strerror(errno));
+        return false;
+    }
+
+    fprintf(file, "P4\n%d %d\n", grid->cols, grid->rows);
+    size_t rowBytes = (grid->cols + 7) / 8;
+    unsigned char *row = calloc(rowBytes, 1);
+    for (int y = 0; y < grid->rows; y++) {
+        memset(row, 0, rowBytes);
+        for (int x = 0; x < grid->cols; x++) {
+            if (gridGet(grid, x, y)) row[x / 8] |= 0x80 >> (x % 8);
         }
+        fwrite(row, 1, rowBytes, file);
     }
+    free(row);
 
-    dvdState->mask = mask;
+    bool result = !ferror(file);
+    fclose(file);
+    if (!result) nob_log(NOB_ERROR, "Could not write %s.", filePath);
+    return result;
 }
 
-void dvd(bool grid[ROWS][COLS], DvdState dvdState) {
-    for (int y = dvdState.origin.y; y < dvdState.origin.y + dvdState.maskHeight; y++) {
-        for (int x = dvdState.origin.x; x < dvdState.origin.x + dvdState.maskWidth; x++) {
-            int maskX = x - dvdState.origin.x;
-            int maskY = y - dvdState.origin.y;
+// One tile per simulation, filled in row by row.
+void drawMenuTiles(MenuState menuState) {
+    int rows = (SIMULATION_COUNT + menuState.cols - 1) / menuState.cols;
+    float outlineWidth = (canvas.windowWidth - (menuState.cols + 1) * menuState.spacing) / menuState.cols;
+    float outlineHeight = (canvas.windowHeight - menuState.titleBarHeight - (rows + 1) * menuState.spacing) / rows;
+    for (int tileIdx = 0; tileIdx < SIMULATION_COUNT; tileIdx++) {
+        int i = tileIdx / menuState.cols;
+        int j = tileIdx % menuState.cols;
+
+        float x = menuState.spacing * (j + 1) + outlineWidth * j;
+        float y = menuState.titleBarHeight + menuState.spacing * (i + 1) + outlineHeight * i;
+        float width = outlineWidth;
+        float height = outlineHeight;
+
+        Rectangle tile = {
+            .x = x,
+            .y = y,
+            .width = width,
+            .height = height,
+        };
+        Color tileColor = tileIdx == menuState.selected ? MAROON : BLACK;
+        DrawRectangleLinesEx(tile, 5.0f, tileColor);
+
+        const char *tileName = simulations[tileIdx].name;
+        DrawText(tileName,
+                 x + width / 2 - MeasureText(tileName, 20) / 2, y + height / 2 - 10,
+                 20, BLACK);
+    }
+}
+
+Screen screenFromName(Nob_String_View name) {
+    for (int i = 0; i < SIMULATION_COUNT; i++) {
+        if (nob_sv_eq(name, nob_sv_from_cstr(simulations[i].name))) return i;
+    }
+    return MENU;
+}
 
-            if (dvdState.mask[dvdState.maskWidth * maskY + maskX]) grid[y][x] = !grid[y][x];
+bool checkScreenList(const char *screenList) {
+    Nob_String_View names = nob_sv_from_cstr(screenList);
+    while (names.count > 0) {
+        Nob_String_View name = nob_sv_chop_by_delim(&names, ',');
+        if (screenFromName(name) == MENU) {
+            nob_log(NOB_ERROR, "Unknown simulation " SV_Fmt ".", SV_Arg(name));
+            return false;
         }
     }
+    return true;
+}
+
+// Step the comma-separated list of simulations for `frames` ticks each, one after another on the
+// same grid (unless they have their own), as fast as possible and without ever opening a window.
+bool runHeadless(const char *screenList, unsigned int frames, const char *dumpPath) {
+    World world = loadWorld();
+    bool result = true;
+
+    Nob_String_View names = nob_sv_from_cstr(screenList);
+    while (names.count > 0) {
+        Nob_String_View name = nob_sv_chop_by_delim(&names, ',');
+        Screen screen = screenFromName(name);
+        if (screen == MENU) {
+            nob_log(NOB_ERROR, "Unknown simulation " SV_Fmt ".", SV_Arg(name));
+            nob_return_defer(false);
+        }
+
+        showScreen(&world, screen);
+        double start = nob_now_seconds();
+        unsigned int tickCount = 0;
+        for (unsigned int frame = 0; frame < frames; frame++) {
+            tickCount = (tickCount + 1) % TICKS_PER_CYCLE;
+            stepWorld(&world, screen, tickCount);
+        }
+        double elapsed = nob_now_seconds() - start;
+
+        nob_log(NOB_INFO, SV_Fmt ": %u frames in %.3fs (%.0f frames/s)",
+                SV_Arg(name), frames, elapsed, elapsed > 0 ? frames / elapsed : 0.0);
+    }
+
+    logSimulationStats(&world);
+    if (shapes) {
+        ShapeCacheStats stats = shapeCacheStats(shapes);
+        nob_log(NOB_INFO, "shape cache: %zu hits, %zu misses, %zu evictions, %zu shapes in %zu bytes",
+                stats.hits, stats.misses, stats.evictions, stats.entries, stats.bytes);
+    }
+    nob_log(NOB_INFO, "checksum: %016llx", (unsigned long long)gridChecksum(&world.grid));
+    if (dumpPath && !dumpGridToPbm(&world.grid, dumpPath)) nob_return_defer(false);
+
+defer:
+    unloadWorld(&world);
+    return result;
+}
+
+void printUsage(const char *program) {
+    nob_log(NOB_INFO, "usage: %s [-width <pixels>] [-height <pixels>] [-tile <pixels>] [-tick-rate <hz>] [-threads <n>] [-pipeline] [-line-count <n>] [-dvd-count <n>]", program);
+    nob_log(NOB_INFO, "       %*s [-life-rule <B/S>]", (int)strlen(program), "");
+    nob_log(NOB_INFO, "       %*s [-shape-cache <KiB>] [-resources <dir>] [-check-circle]", (int)strlen(program), "");
+    nob_log(NOB_INFO, "       %*s [-headless <simulations>] [-script <simulations>] [-frames <n>] [-seed <n>] [-dump <file.pbm>]", (int)strlen(program), "");
+    nob_log(NOB_INFO, "    -width <pixels>     width of the window, 800 by default");
+    nob_log(NOB_INFO, "    -height <pixels>    height of the window, 600 by default");
+    nob_log(NOB_INFO, "    -tile <pixels>      size of a single tile, 5 by default");
+    nob_log(NOB_INFO, "    -tick-rate <hz>     simulation ticks per second regardless of the frame rate, 60 by default");
+    nob_log(NOB_INFO, "    -threads <n>        threads to split full-canvas grid operations over, all CPUs by default");
+    nob_log(NOB_INFO, "    -pipeline           run the simulations on their own thread, overlapping with rendering");
+    nob_log(NOB_INFO, "    -line-count <n>     number of random lines drawn at once, 1 by default");
+    nob_log(NOB_INFO, "    -dvd-count <n>      number of dvd logos bouncing around at once, 1 by default");
+    nob_log(NOB_INFO, "    -life-rule <B/S>    birth and survival rule of the life screen, B3/S23 by default");
+    nob_log(NOB_INFO, "    -shape-cache <KiB>  memory for caching the circles circle() draws, 0 (off) by default");
+    nob_log(NOB_INFO, "    -resources <dir>    load the icon and the dvd mask from <dir> instead of the copies built in");
+    nob_log(NOB_INFO, "    -check-circle       compare circle() against the brute-force version and exit");
+    Nob_String_Builder names = {0};
+    for (int i = 0; i < SIMULATION_COUNT; i++) {
+        nob_sb_append_cstr(&names, i > 0 ? ", " : "");
+        nob_sb_append_cstr(&names, simulations[i].name);
+    }
+    nob_log(NOB_INFO, "    -headless <sims>    run the comma-separated simulations (" SV_Fmt ") without a window", (int)names.count, names.items);
+    nob_sb_free(names);
+    nob_log(NOB_INFO, "    -script <sims>      show the comma-separated simulations in the window one after another, then quit");
+    nob_log(NOB_INFO, "    -frames <n>         frames to run each headless or scripted simulation for, 600 by default");
+    nob_log(NOB_INFO, "    -seed <n>           random seed, the current time by default");
+    nob_log(NOB_INFO, "    -dump <file.pbm>    write the final headless frame to a .pbm file");
 }
 
-int main(void) {
-    SetRandomSeed(time(NULL));
+// Pop the value of `flag` off the arguments as an integer no smaller than `minimum`.
+bool shiftIntAtLeast(const char *flag, int minimum, int *argc, char ***argv, int *value) {
+    if (*argc == 0) {
+        nob_log(NOB_ERROR, "%s expects a value.", flag);
+        return false;
+    }
+
+    const char *arg = nob_shift_args(argc, argv);
+    char *end;
+    long parsed = strtol(arg, &end, 10);
+    if (*end != '\0' || parsed < minimum || parsed > INT_MAX) {
+        nob_log(NOB_ERROR, "%s expects an integer of at least %d, got %s.", flag, minimum, arg);
+        return false;
+    }
+
+    *value = parsed;
+    return true;
+}
+
+bool shiftPositiveInt(const char *flag, int *argc, char ***argv, int *value) {
+    return shiftIntAtLeast(flag, 1, argc, argv, value);
+}
+
+int main(int argc, char **argv) {
+    const char *program = nob_shift_args(&argc, &argv);
+    bool runCheckCircle = false;
+    bool usePipeline = false;
+    int threadCount = nob_nprocs();
+    const char *headlessScreens = NULL;
+    const char *scriptScreens = NULL;
+    int frames = 600;
+    int seed = time(NULL);
+    const char *dumpPath = NULL;
+    while (argc > 0) {
+        const char *flag = nob_shift_args(&argc, &argv);
+        if (strcmp(flag, "-width") == 0) {
+            if (!shiftPositiveInt(flag, &argc, &argv, &canvas.windowWidth)) return 1;
+        } else if (strcmp(flag, "-height") == 0) {
+            if (!shiftPositiveInt(flag, &argc, &argv, &canvas.windowHeight)) return 1;
+        } else if (strcmp(flag, "-tile") == 0) {
+            if (!shiftPositiveInt(flag, &argc, &argv, &canvas.tileSize)) return 1;
+        } else if (strcmp(flag, "-tick-rate") == 0) {
+            if (!shiftPositiveInt(flag, &argc, &argv, &tickRate)) return 1;
+        } else if (strcmp(flag, "-threads") == 0) {
+            if (!shiftPositiveInt(flag, &argc, &argv, &threadCount)) return 1;
+        } else if (strcmp(flag, "-line-count") == 0) {
+            if (!shiftPositiveInt(flag, &argc, &argv, &lineCount)) return 1;
+        } else if (strcmp(flag, "-dvd-count") == 0) {
+            if (!shiftPositiveInt(flag, &argc, &argv, &dvdCount)) return 1;
+        } else if (strcmp(flag, "-pipeline") == 0) {
+            usePipeline = true;
+        } else if (strcmp(flag, "-life-rule") == 0 && argc > 0) {
+            const char *rule = nob_shift_args(&argc, &argv);
+            if (!parseLifeRule(rule, &lifeRule)) {
+                nob_log(NOB_ERROR, "-life-rule expects a rule like B3/S23, got %s.", rule);
+                return 1;
+            }
+        } else if (strcmp(flag, "-shape-cache") == 0) {
+            if (!shiftIntAtLeast(flag, 0, &argc, &argv, &shapeCacheKiB)) return 1;
+        } else if (strcmp(flag, "-resources") == 0 && argc > 0) {
+            resourcesPath = nob_shift_args(&argc, &argv);
+        } else if (strcmp(flag, "-check-circle") == 0) {
+            runCheckCircle = true;
+        } else if (strcmp(flag, "-headless") == 0 && argc > 0) {
+            headlessScreens = nob_shift_args(&argc, &argv);
+        } else if (strcmp(flag, "-script") == 0 && argc > 0) {
+            scriptScreens = nob_shift_args(&argc, &argv);
+        } else if (strcmp(flag, "-frames") == 0) {
+            if (!shiftPositiveInt(flag, &argc, &argv, &frames)) return 1;
+        } else if (strcmp(flag, "-seed") == 0) {
+            if (!shiftPositiveInt(flag, &argc, &argv, &seed)) return 1;
+        } else if (strcmp(flag, "-dump") == 0 && argc > 0) {
+            dumpPath = nob_shift_args(&argc, &argv);
+        } else {
+            printUsage(program);
+            return 1;
+        }
+    }
+
+    canvas.rows = canvas.windowHeight / canvas.tileSize;
+    canvas.cols = canvas.windowWidth / canvas.tileSize;
+    if (canvas.rows == 0 || canvas.cols == 0) {
+        nob_log(NOB_ERROR, "Tiles of %dpx don't fit in a %dx%d window.", canvas.tileSize, canvas.windowWidth, canvas.windowHeight);
+        return 1;
+    }
+
+    workers = workerPoolCreate(threadCount);
+    if (!workers) nob_log(NOB_WARNING, "Could not start %d threads, running on one.", threadCount);
+
+    if (shapeCacheKiB > 0) {
+        shapes = shapeCacheCreate((size_t)shapeCacheKiB * 1024);
+        if (!shapes) nob_log(NOB_WARNING, "Could not allocate the shape cache, drawing without it.");
+    }
 
-    bool grid[ROWS][COLS] = {false};
-    initGrid(grid);
+    if (runCheckCircle) {
+        bool matches = checkCircle();
+        shapeCacheDestroy(shapes);
+        workerPoolDestroy(workers);
+        return matches ? 0 : 1;
+    }
 
-    InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "pov: brain is weird");
+    SetRandomSeed(seed);
+
+    if (headlessScreens) {
+        bool ok = runHeadless(headlessScreens, frames, dumpPath);
+        shapeCacheDestroy(shapes);
+        workerPoolDestroy(workers);
+        return ok ? 0 : 1;
+    }
+
+    if (scriptScreens && !checkScreenList(scriptScreens)) return 1;
+    Nob_String_View script = nob_sv_from_cstr(scriptScreens ? scriptScreens : "");
+    int scriptFrames = 0;
+
+    World world = loadWorld();
+
+    // Render at the display's refresh rate, the simulations keep their own pace anyway.
+    SetConfigFlags(FLAG_VSYNC_HINT);
+    InitWindow(canvas.windowWidth, canvas.windowHeight, "pov: brain is weird");
     SetExitKey(KEY_NULL);
-    SetWindowIcon(LoadImage("./resources/pov-you-wake-up-in-poland.png"));
-    SetTargetFPS(60);
+    setWindowIcon();
+    SetTargetFPS(GetMonitorRefreshRate(GetCurrentMonitor()));
+
+    GridRenderer gridRenderer = loadGridRenderer();
+
+    Pipeline pipeline;
+    if (usePipeline && !startPipeline(&pipeline, &world)) usePipeline = false;
 
     Screen currentScreen = MENU;
     MenuState menuState = {
-        .rows = 2,
         .cols = 3,
         .spacing = 40,
         .titleBarHeight = 40,
-        .selectedTile = {0, 0},
+        .selected = 0,
     };
 
-    LinesState linesState = {
-        .p1 = {0},
-        .p2 = {0}};
-
-    ClockState clockState = {
-        .radius = ROWS / 2 * 3 / 4,
-        .handOrigin = {COLS / 2, ROWS / 2},
-        .handDest = {COLS / 2, ROWS / 2 - clockState.radius}};
-
-    DvdState dvdState = {0};
-    parseMaskFromPbm("./resources/dvd.pbm", &dvdState);
-    dvdState.direction = (Vector2){1, 1};
-    int originX = GetRandomValue(0, COLS - dvdState.maskWidth);
-    int originY = GetRandomValue(0, ROWS - dvdState.maskHeight);
-    dvdState.origin = (Vector2){originX, originY};
-
+    // The texture starts out blank, so the whole grid has to be uploaded once.
+    GridRect dirty = gridBounds(&world.grid);
     bool paused = false;
-    unsigned int frameCount = 0;
+    unsigned int tickCount = 0;
+    double tickDuration = 1.0 / tickRate;
+    double tickBacklog = 0.0;
+    double lastTime = GetTime();
     while (!WindowShouldClose()) {
-        frameCount = (frameCount + 1) % 60;
-
-        switch (currentScreen) {
-            case MENU: {
-                if (IsKeyPressed(KEY_ENTER)) {
-                    short screenIdx = menuState.selectedTile.y * menuState.cols + menuState.selectedTile.x;
-                    currentScreen = screens[screenIdx];
-                }
-
-                if (IsKeyPressed(KEY_LEFT))
-                    menuState.selectedTile.x = euclideanModulo((int)menuState.selectedTile.x - 1, menuState.cols);
-                if (IsKeyPressed(KEY_UP))
-                    menuState.selectedTile.y = euclideanModulo((int)menuState.selectedTile.y - 1, menuState.rows);
-                if (IsKeyPressed(KEY_RIGHT))
-                    menuState.selectedTile.x = ((int)menuState.selectedTile.x + 1) % menuState.cols;
-                if (IsKeyPressed(KEY_DOWN))
-                    menuState.selectedTile.y = ((int)menuState.selectedTile.y + 1) % menuState.rows;
-            } break;
-
-            case LINES:
-            case CLOCK:
-            case DVD:
-            default: {
-                if (IsKeyPressed(KEY_ESCAPE)) currentScreen = MENU;
-
-                if (IsKeyPressed(KEY_P)) paused = !paused;
-            } break;
+        if (scriptScreens) {
+            // A scripted run shows every simulation for `frames` frames, then quits after the last.
+            if (currentScreen == MENU || ++scriptFrames >= frames) {
+                if (script.count == 0) break;
+                currentScreen = screenFromName(nob_sv_chop_by_delim(&script, ','));
+                scriptFrames = 0;
+            }
+        } else if (currentScreen == MENU) {
+            if (IsKeyPressed(KEY_ENTER)) currentScreen = menuState.selected;
+
+            // Left and right go through the tiles in order, up and down only if there's a tile there.
+            if (IsKeyPressed(KEY_LEFT))
+                menuState.selected = euclideanModulo(menuState.selected - 1, SIMULATION_COUNT);
+            if (IsKeyPressed(KEY_RIGHT))
+                menuState.selected = (menuState.selected + 1) % SIMULATION_COUNT;
+            if (IsKeyPressed(KEY_UP) && menuState.selected - menuState.cols >= 0)
+                menuState.selected -= menuState.cols;
+            if (IsKeyPressed(KEY_DOWN) && menuState.selected + menuState.cols < SIMULATION_COUNT)
+                menuState.selected += menuState.cols;
+        } else {
+            if (IsKeyPressed(KEY_ESCAPE)) currentScreen = MENU;
+
+            if (IsKeyPressed(KEY_P)) paused = !paused;
+        }
+
+        if (usePipeline) {
+            // The simulation thread keeps its own backlog, see runPipeline().
+            atomic_store(&pipeline.screen, currentScreen);
+            atomic_store(&pipeline.paused, paused);
+        } else {
+            dirty = gridRectUnion(dirty, showScreen(&world, currentScreen));
+
+            // Run as many ticks as fit in the time since the last frame, so a slow frame doesn't
+            // slow the simulation down. Past MAX_CATCH_UP_TICKS it's hopeless to catch up, so the
+            // rest of the backlog is dropped instead of making the next frame even slower.
+            double now = GetTime();
+            tickBacklog += now - lastTime;
+            lastTime = now;
+            int ticks = 0;
+            while (tickBacklog >= tickDuration && ticks < MAX_CATCH_UP_TICKS) {
+                tickCount = (tickCount + 1) % TICKS_PER_CYCLE;
+                if (!paused) dirty = gridRectUnion(dirty, stepWorld(&world, currentScreen, tickCount));
+                tickBacklog -= tickDuration;
+                ticks++;
+            }
+            if (tickBacklog >= tickDuration) tickBacklog = 0.0;
         }
 
         BeginDrawing();
 
         ClearBackground(RAYWHITE);
 
-        switch (currentScreen) {
-            case MENU: {
-                DrawText("pov: brain is weird",
-                         WINDOW_WIDTH / 2 - MeasureText("pov: brain is weird", 20) / 2, 10,
-                         20, BLACK);
-
-                Vector2 separatorStart = {0, menuState.titleBarHeight};
-                Vector2 separatorEnd = {WINDOW_WIDTH, menuState.titleBarHeight};
-                DrawLineEx(separatorStart, separatorEnd, 3, BLACK);
-
-                drawMenuTiles(menuState);
-            } break;
-
-            case LINES: {
-                if (!paused && frameCount % 15 == 0) {
-                    linesState.p1.x = GetRandomValue(0, COLS);
-                    linesState.p1.y = GetRandomValue(0, ROWS);
-                    linesState.p2.x = GetRandomValue(0, COLS);
-                    linesState.p2.y = GetRandomValue(0, ROWS);
-                    lineV(grid, linesState.p1, linesState.p2);
-                }
-
-                drawGrid(grid);
-            } break;
-
-            case CLOCK: {
-                if (!paused && frameCount % 3 == 0) circle(grid, clockState.handOrigin, clockState.radius);
-
-                if (!paused && frameCount == 0) {
-                    Vector2 v = {clockState.handDest.x - clockState.handOrigin.x, clockState.handDest.y - clockState.handOrigin.y};
-                    v.x = v.x * cos(CLOCK_STEP) - v.y * sin(CLOCK_STEP);
-                    v.y = v.x * sin(CLOCK_STEP) + v.y * cos(CLOCK_STEP);
-
-                    clockState.handDest.x = round(clockState.handOrigin.x + v.x);
-                    clockState.handDest.y = round(clockState.handOrigin.y + v.y);
-
-                    lineV(grid, clockState.handOrigin, clockState.handDest);
-                }
-
-                drawGrid(grid);
-            } break;
-
-            case DVD: {
-                if (!paused && frameCount % 2 == 0) {
-                    // collision checks
-                    // top
-                    if (dvdState.origin.y == 0)
-                        dvdState.direction.y = 1;
-                    // right
-                    if (dvdState.origin.x + dvdState.maskWidth == COLS)
-                        dvdState.direction.x = -1;
-                    // bottom
-                    if (dvdState.origin.y + dvdState.maskHeight == ROWS)
-                        dvdState.direction.y = -1;
-                    // left
-                    if (dvdState.origin.x == 0)
-                        dvdState.direction.x = 1;
-
-                    dvdState.origin.x += dvdState.direction.x;
-                    dvdState.origin.y += dvdState.direction.y;
-                    dvd(grid, dvdState);
-                }
-
-                drawGrid(grid);
-            } break;
-
-            default: {
-                DrawText("you shouldn't be here",
-                         WINDOW_WIDTH / 2 - MeasureText("you shouldn't be here", 20) / 2, WINDOW_HEIGHT / 2 - 10,
-                         20, BLACK);
-            } break;
+        if (currentScreen == MENU) {
+            DrawText("pov: brain is weird",
+                     canvas.windowWidth / 2 - MeasureText("pov: brain is weird", 20) / 2, 10,
+                     20, BLACK);
+
+            Vector2 separatorStart = {0, menuState.titleBarHeight};
+            Vector2 separatorEnd = {canvas.windowWidth, menuState.titleBarHeight};
+            DrawLineEx(separatorStart, separatorEnd, 3, BLACK);
+
+            drawMenuTiles(menuState);
+        } else {
+            const Grid *shown = usePipeline ? acquirePipelineGrid(&pipeline, &dirty) : &world.grid;
+            drawGrid(shown, gridRenderer, dirty);
+            dirty = GRID_RECT_EMPTY;
         }
 
         EndDrawing();
     }
 
+    if (usePipeline) stopPipeline(&pipeline);
+    unloadGridRenderer(gridRenderer);
     CloseWindow();
 
+    logSimulationStats(&world);
+    unloadWorld(&world);
+    shapeCacheDestroy(shapes);
+    workerPoolDestroy(workers);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,277 @@
+// Cache of rasterized shapes, for primitives that get drawn with the same parameters over and over.
+// A shape is rasterized once, clipped to the grid, into spans (see GridSpans in grid.h), and from
+// then on drawing it is just XORing the spans back in. Entries are keyed on the kind of shape, its
+// parameters and the size of the grid, and the least recently drawn ones are evicted once the cache
+// goes over its memory budget. Shapes bigger than the whole budget are drawn without being cached.
+//
+// A cache isn't thread-safe, every thread drawing through one needs its own. A NULL cache draws
+// everything directly, so callers don't need a second code path.
+//
+// Like nob.h, this is a single-header library: define SHAPES_IMPLEMENTATION in exactly one
+// translation unit before including it. Needs grid.h.
+
+#ifndef SHAPES_H_
+#define SHAPES_H_
+
+#include <stddef.h>
+
+#include "grid.h"
+
+typedef struct ShapeCache ShapeCache;
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries;
+    size_t bytes;  // memory held by the entries, counted against the budget
+} ShapeCacheStats;
+
+// Returns NULL if the cache couldn't be allocated.
+ShapeCache *shapeCacheCreate(size_t budgetBytes);
+void shapeCacheDestroy(ShapeCache *cache);
+
+ShapeCacheStats shapeCacheStats(const ShapeCache *cache);
+
+// gridXorLine() and gridXorCircle() going through the cache.
+GridRect shapeXorLine(ShapeCache *cache, Grid *grid, int x1, int y1, int x2, int y2);
+GridRect shapeXorCircle(ShapeCache *cache, Grid *grid, int x, int y, int radius);
+
+#endif  // SHAPES_H_
+
+#ifdef SHAPES_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SHAPE_MIN_BUCKETS 64
+
+typedef enum {
+    SHAPE_LINE,
+    SHAPE_CIRCLE,
+} ShapeKind;
+
+typedef struct {
+    ShapeKind kind;
+    int params[4];
+    int rows;  // the grid the shape was clipped to
+    int cols;
+} ShapeKey;
+
+typedef struct ShapeEntry ShapeEntry;
+struct ShapeEntry {
+    ShapeKey key;
+    uint64_t hash;
+    GridSpans spans;
+    GridRect rect;  // where the spans go on the grid
+    size_t bytes;
+    ShapeEntry *next;  // in the same bucket
+    ShapeEntry *newer;  // LRU list, most recently drawn first
+    ShapeEntry *older;
+};
+
+struct ShapeCache {
+    size_t budget;
+    ShapeEntry **buckets;
+    size_t bucketCount;  // a power of two
+    ShapeEntry *newest;
+    ShapeEntry *oldest;
+    ShapeCacheStats stats;
+};
+
+ShapeCache *shapeCacheCreate(size_t budgetBytes) {
+    ShapeCache *cache = calloc(1, sizeof(ShapeCache));
+    if (!cache) return NULL;
+
+    cache->budget = budgetBytes;
+    cache->bucketCount = SHAPE_MIN_BUCKETS;
+    cache->buckets = calloc(cache->bucketCount, sizeof(ShapeEntry *));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static void shapeFreeEntry(ShapeEntry *entry) {
+    gridFreeSpans(&entry->spans);
+    free(entry);
+}
+
+void shapeCacheDestroy(ShapeCache *cache) {
+    if (!cache) return;
+
+    ShapeEntry *entry = cache->newest;
+    while (entry) {
+        ShapeEntry *older = entry->older;
+        shapeFreeEntry(entry);
+        entry = older;
+    }
+    free(cache->buckets);
+    free(cache);
+}
+
+ShapeCacheStats shapeCacheStats(const ShapeCache *cache) {
+    return cache ? cache->stats : (ShapeCacheStats){0};
+}
+
+// FNV-1a over the key's fields.
+static uint64_t shapeHash(const ShapeKey *key) {
+    int fields[] = {key->kind, key->params[0], key->params[1], key->params[2], key->params[3], key->rows, key->cols};
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        hash ^= (uint32_t)fields[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static bool shapeKeyEquals(const ShapeKey *a, const ShapeKey *b) {
+    return a->kind == b->kind && a->rows == b->rows && a->cols == b->cols &&
+           memcmp(a->params, b->params, sizeof(a->params)) == 0;
+}
+
+static void shapeUnlinkLru(ShapeCache *cache, ShapeEntry *entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else cache->newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else cache->oldest = entry->newer;
+}
+
+static void shapePushLru(ShapeCache *cache, ShapeEntry *entry) {
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if (cache->newest) cache->newest->newer = entry;
+    cache->newest = entry;
+    if (!cache->oldest) cache->oldest = entry;
+}
+
+static void shapeEvictOldest(ShapeCache *cache) {
+    ShapeEntry *entry = cache->oldest;
+    shapeUnlinkLru(cache, entry);
+
+    ShapeEntry **link = &cache->buckets[entry->hash & (cache->bucketCount - 1)];
+    while (*link != entry) link = &(*link)->next;
+    *link = entry->next;
+
+    cache->stats.bytes -= entry->bytes;
+    cache->stats.entries--;
+    cache->stats.evictions++;
+    shapeFreeEntry(entry);
+}
+
+// Double the buckets once there are more entries than buckets. Failing to grow just makes the
+// chains longer.
+static void shapeGrowBuckets(ShapeCache *cache) {
+    if (cache->stats.entries < cache->bucketCount) return;
+
+    size_t bucketCount = cache->bucketCount * 2;
+    ShapeEntry **buckets = calloc(bucketCount, sizeof(ShapeEntry *));
+    if (!buckets) return;
+
+    for (size_t i = 0; i < cache->bucketCount; i++) {
+        ShapeEntry *entry = cache->buckets[i];
+        while (entry) {
+            ShapeEntry *next = entry->next;
+            entry->next = buckets[entry->hash & (bucketCount - 1)];
+            buckets[entry->hash & (bucketCount - 1)] = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucketCount = bucketCount;
+}
+
+// Draw the shape into a scratch grid covering just `rect`, then compile that into spans. Both
+// rasterizers only depend on where the shape is relative to the grid, so shifting everything by
+// `rect`'s corner gives the same tiles.
+static ShapeEntry *shapeRasterize(const ShapeKey *key, GridRect rect) {
+    ShapeEntry *entry = calloc(1, sizeof(ShapeEntry));
+    if (!entry) return NULL;
+    entry->key = *key;
+    entry->hash = shapeHash(key);
+    entry->rect = rect;
+
+    Grid scratch = gridAlloc(rect.y2 - rect.y1, rect.x2 - rect.x1);
+    if (!scratch.words) {
+        free(entry);
+        return NULL;
+    }
+    const int *p = key->params;
+    if (key->kind == SHAPE_LINE) {
+        gridXorLine(&scratch, p[0] - rect.x1, p[1] - rect.y1, p[2] - rect.x1, p[3] - rect.y1);
+    } else {
+        gridXorCircle(&scratch, p[0] - rect.x1, p[1] - rect.y1, p[2]);
+    }
+    bool compiled = gridCompileSpans(&scratch, &entry->spans);
+    gridFree(&scratch);
+    if (!compiled) {
+        free(entry);
+        return NULL;
+    }
+
+    entry->bytes = sizeof(ShapeEntry) + ((size_t)entry->spans.spanCount + 1) * sizeof(GridSpan) +
+                   ((size_t)entry->spans.rows + 1) * sizeof(int);
+    return entry;
+}
+
+// Look the shape up, rasterizing and caching it on a miss. Returns NULL if it can't be cached, in
+// which case the caller draws it directly.
+static ShapeEntry *shapeLookup(ShapeCache *cache, const ShapeKey *key, GridRect rect) {
+    uint64_t hash = shapeHash(key);
+    for (ShapeEntry *entry = cache->buckets[hash & (cache->bucketCount - 1)]; entry; entry = entry->next) {
+        if (entry->hash != hash || !shapeKeyEquals(&entry->key, key)) continue;
+
+        cache->stats.hits++;
+        shapeUnlinkLru(cache, entry);
+        shapePushLru(cache, entry);
+        return entry;
+    }
+
+    cache->stats.misses++;
+    ShapeEntry *entry = shapeRasterize(key, rect);
+    if (!entry) return NULL;
+    if (entry->bytes > cache->budget) {
+        shapeFreeEntry(entry);
+        return NULL;
+    }
+
+    while (cache->stats.bytes + entry->bytes > cache->budget) shapeEvictOldest(cache);
+    shapeGrowBuckets(cache);
+    ShapeEntry **bucket = &cache->buckets[hash & (cache->bucketCount - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    shapePushLru(cache, entry);
+    cache->stats.bytes += entry->bytes;
+    cache->stats.entries++;
+    return entry;
+}
+
+GridRect shapeXorLine(ShapeCache *cache, Grid *grid, int x1, int y1, int x2, int y2) {
+    GridRect rect = gridRectClip(grid, gridSegmentBounds((GridSegment){x1, y1, x2, y2}));
+    if (!cache || gridRectIsEmpty(rect)) return gridXorLine(grid, x1, y1, x2, y2);
+
+    ShapeKey key = {.kind = SHAPE_LINE, .params = {x1, y1, x2, y2}, .rows = grid->rows, .cols = grid->cols};
+    ShapeEntry *entry = shapeLookup(cache, &key, rect);
+    if (!entry) return gridXorLine(grid, x1, y1, x2, y2);
+
+    gridXorSpans(grid, &entry->spans, rect.x1, rect.y1);
+    return rect;
+}
+
+GridRect shapeXorCircle(ShapeCache *cache, Grid *grid, int x, int y, int radius) {
+    if (radius < 0) return GRID_RECT_EMPTY;
+
+    GridRect rect = gridRectClip(grid, (GridRect){x - radius, y - radius, x + radius + 1, y + radius + 1});
+    if (!cache || gridRectIsEmpty(rect)) return gridXorCircle(grid, x, y, radius);
+
+    ShapeKey key = {.kind = SHAPE_CIRCLE, .params = {x, y, radius}, .rows = grid->rows, .cols = grid->cols};
+    ShapeEntry *entry = shapeLookup(cache, &key, rect);
+    if (!entry) return gridXorCircle(grid, x, y, radius);
+
+    gridXorSpans(grid, &entry->spans, rect.x1, rect.y1);
+    return rect;
+}
+
+#endif  // SHAPES_IMPLEMENTATION
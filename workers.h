@@ -0,0 +1,210 @@
+// Persistent pool of worker threads for splitting work on a grid into bands of rows.
+//
+// workerPoolRun() hands out the bands to the workers and the calling thread alike, and only returns
+// once all of them are done, which doubles as the barrier before the results get used (e.g.
+// uploaded to the GPU). Bands are never thinner than WORKER_MIN_BAND_ROWS rows, so small jobs
+// just run on the calling thread without waking anybody up. Several threads may share a pool: while
+// one job is in flight, jobs submitted from other threads run on their own calling thread instead.
+//
+// Like nob.h, this is a single-header library: define WORKERS_IMPLEMENTATION in exactly one
+// translation unit before including it. Needs to be linked with -pthread, unless WORKERS_NO_THREADS
+// is defined too, in which case workerPoolCreate() always fails and everything runs on the calling
+// thread (for nob.c, which gets built with a bare `cc -o nob nob.c`).
+
+#ifndef WORKERS_H_
+#define WORKERS_H_
+
+#include <stdbool.h>
+
+#define WORKER_MIN_BAND_ROWS 16
+#define WORKER_BANDS_PER_THREAD 4  // more bands than threads, so uneven bands even out
+
+// Processes rows [y1, y2) of whatever `context` describes.
+typedef void (*WorkerBandFn)(void *context, int y1, int y2);
+
+typedef struct WorkerPool WorkerPool;
+
+// Create a pool of `threadCount` threads in total, the calling thread included, so 1 means no
+// worker threads at all. Returns NULL if the threads couldn't be started.
+WorkerPool *workerPoolCreate(int threadCount);
+void workerPoolDestroy(WorkerPool *pool);
+
+// Run `fn` over rows [y1, y2) split in bands and wait for all of them to finish. A NULL pool runs
+// everything on the calling thread.
+void workerPoolRun(WorkerPool *pool, int y1, int y2, WorkerBandFn fn, void *context);
+
+// Number of threads workerPoolRun() spreads the work over.
+int workerPoolThreadCount(const WorkerPool *pool);
+
+#endif  // WORKERS_H_
+
+#if defined(WORKERS_IMPLEMENTATION) && !defined(WORKERS_IMPLEMENTED_)
+#define WORKERS_IMPLEMENTED_  // other headers include this one too
+
+#include <stdlib.h>
+
+#ifdef WORKERS_NO_THREADS
+
+WorkerPool *workerPoolCreate(int threadCount) {
+    (void)threadCount;
+    return NULL;
+}
+
+void workerPoolDestroy(WorkerPool *pool) {
+    (void)pool;
+}
+
+void workerPoolRun(WorkerPool *pool, int y1, int y2, WorkerBandFn fn, void *context) {
+    (void)pool;
+    if (y1 < y2) fn(context, y1, y2);
+}
+
+int workerPoolThreadCount(const WorkerPool *pool) {
+    (void)pool;
+    return 1;
+}
+
+#else
+
+#    include <pthread.h>
+
+struct WorkerPool {
+    pthread_t *threads;
+    int threadCount;  // worker threads, not counting the one calling workerPoolRun()
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    bool quit;
+    bool busy;  // a job is in flight, so other callers have to do their own work
+
+    // The job being run, guarded by mutex. Workers wake up whenever generation changes.
+    unsigned long generation;
+    WorkerBandFn fn;
+    void *context;
+    int y1;
+    int y2;
+    int bandRows;
+    int nextBand;
+    int bandCount;
+    int pendingBands;
+};
+
+// Take bands of the current job until there are none left. Called and returns with the mutex held.
+static void workerRunBands(WorkerPool *pool) {
+    while (pool->nextBand < pool->bandCount) {
+        int band = pool->nextBand++;
+        int y1 = pool->y1 + band * pool->bandRows;
+        int y2 = y1 + pool->bandRows < pool->y2 ? y1 + pool->bandRows : pool->y2;
+        WorkerBandFn fn = pool->fn;
+        void *context = pool->context;
+
+        pthread_mutex_unlock(&pool->mutex);
+        fn(context, y1, y2);
+        pthread_mutex_lock(&pool->mutex);
+
+        if (--pool->pendingBands == 0) pthread_cond_signal(&pool->done);
+    }
+}
+
+static void *workerMain(void *arg) {
+    WorkerPool *pool = arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->quit && pool->generation == seen) pthread_cond_wait(&pool->wake, &pool->mutex);
+        if (pool->quit) break;
+
+        seen = pool->generation;
+        workerRunBands(pool);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+WorkerPool *workerPoolCreate(int threadCount) {
+    WorkerPool *pool = calloc(1, sizeof(WorkerPool));
+    if (!pool) return NULL;
+
+    pool->threadCount = threadCount > 1 ? threadCount - 1 : 0;
+    pool->threads = calloc(pool->threadCount + 1, sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (int i = 0; i < pool->threadCount; i++) {
+        if (pthread_create(&pool->threads[i], NULL, workerMain, pool) != 0) {
+            pool->threadCount = i;
+            workerPoolDestroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void workerPoolDestroy(WorkerPool *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->threadCount; i++) pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->threads);
+    free(pool);
+}
+
+void workerPoolRun(WorkerPool *pool, int y1, int y2, WorkerBandFn fn, void *context) {
+    if (y1 >= y2) return;
+
+    int rows = y2 - y1;
+    int maxBands = workerPoolThreadCount(pool) * WORKER_BANDS_PER_THREAD;
+    int bandCount = rows / WORKER_MIN_BAND_ROWS;
+    if (bandCount > maxBands) bandCount = maxBands;
+    if (!pool || pool->threadCount == 0 || bandCount <= 1) {
+        fn(context, y1, y2);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->busy) {
+        pthread_mutex_unlock(&pool->mutex);
+        fn(context, y1, y2);
+        return;
+    }
+    pool->busy = true;
+    pool->fn = fn;
+    pool->context = context;
+    pool->y1 = y1;
+    pool->y2 = y2;
+    pool->bandRows = (rows + bandCount - 1) / bandCount;
+    pool->bandCount = (rows + pool->bandRows - 1) / pool->bandRows;
+    pool->nextBand = 0;
+    pool->pendingBands = pool->bandCount;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+
+    workerRunBands(pool);
+    while (pool->pendingBands > 0) pthread_cond_wait(&pool->done, &pool->mutex);
+    pool->busy = false;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+int workerPoolThreadCount(const WorkerPool *pool) {
+    return pool ? pool->threadCount + 1 : 1;
+}
+
+#endif  // WORKERS_NO_THREADS
+
+#endif  // WORKERS_IMPLEMENTATION